@@ -53,8 +53,24 @@ struct Region {
     uintptr_t data[];
 };
 
+// Collected for every arena, sizes are in bytes
+typedef struct {
+    // How many times new_region was called
+    size_t regions;
+    // How many times an existing region was skipped
+    size_t skipped;
+    // How many times an allocation exceeded ARENA_REGION_DEFAULT_CAPACITY
+    size_t oversized;
+    size_t requested;
+    size_t reserved;
+    // Allocated from regions, including padding and abandoned blocks
+    size_t used;
+    size_t peak;
+} Arena_Stats;
+
 typedef struct {
     Region *begin, *end;
+    Arena_Stats stats;
 } Arena;
 
 typedef struct  {
@@ -66,6 +82,11 @@ typedef struct  {
 #define ARENA_REGION_DEFAULT_CAPACITY (8*1024)
 #endif // ARENA_REGION_DEFAULT_CAPACITY
 
+// Each new region is twice the size of the last one, up to this capacity
+#ifndef ARENA_REGION_MAX_CAPACITY
+#define ARENA_REGION_MAX_CAPACITY (1024*1024)
+#endif // ARENA_REGION_MAX_CAPACITY
+
 Region *new_region(size_t capacity);
 void free_region(Region *r);
 
@@ -84,6 +105,12 @@ void arena_reset(Arena *a);
 void arena_rewind(Arena *a, Arena_Mark m);
 void arena_free(Arena *a);
 void arena_trim(Arena *a);
+// Account for from's allocations in into, as if from was freed afterwards
+void arena_stats_merge(Arena_Stats *into, const Arena_Stats *from);
+// Add from to into for arenas that are alive at the same time. When
+// each peaked is unknown, so the peak is a lower bound: the higher of
+// the two peaks and of what both use now.
+void arena_stats_add(Arena_Stats *into, const Arena_Stats *from);
 
 #ifndef ARENA_DA_INIT_CAP
 #define ARENA_DA_INIT_CAP 256
@@ -146,6 +173,7 @@ void arena_trim(Arena *a);
 #ifdef ARENA_IMPLEMENTATION
 
 #if ARENA_BACKEND == ARENA_BACKEND_LIBC_MALLOC
+#include <stdio.h>
 #include <stdlib.h>
 
 // TODO: instead of accepting specific capacity new_region() should accept the size of the object we want to fit into the region
@@ -155,7 +183,10 @@ Region *new_region(size_t capacity)
     size_t size_bytes = sizeof(Region) + sizeof(uintptr_t)*capacity;
     // TODO: it would be nice if we could guarantee that the regions are allocated by ARENA_BACKEND_LIBC_MALLOC are page aligned
     Region *r = (Region*)malloc(size_bytes);
-    ARENA_ASSERT(r); // TODO: since ARENA_ASSERT is disableable go through all the places where we use it to check for failed memory allocation and return with NULL there.
+    if (r == NULL) {
+        perror("Failed to allocate memory.");
+        exit(1);
+    }
     r->next = NULL;
     r->count = 0;
     r->capacity = capacity;
@@ -167,14 +198,44 @@ void free_region(Region *r)
     free(r);
 }
 #elif ARENA_BACKEND == ARENA_BACKEND_LINUX_MMAP
+#include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <sys/mman.h>
 
+// Address space reserved by every region. Pages are only committed by
+// the kernel when first touched, so an arena rarely needs a second region
+// and its last allocation can keep growing in place.
+#ifndef ARENA_MMAP_RESERVE
+#define ARENA_MMAP_RESERVE (sizeof(void*) == 8 ? (size_t)1 << 30 : (size_t)16 << 20)
+#endif // ARENA_MMAP_RESERVE
+
+static Region *map_region(size_t size_bytes)
+{
+    Region *r = mmap(NULL, size_bytes, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+    if (r == MAP_FAILED) return NULL;
+#if defined(ARENA_MMAP_HUGEPAGE) && defined(MADV_HUGEPAGE)
+    // Only a hint, regions stay usable without huge pages
+    madvise(r, size_bytes, MADV_HUGEPAGE);
+#endif
+    return r;
+}
+
 Region *new_region(size_t capacity)
 {
     size_t size_bytes = sizeof(Region) + sizeof(uintptr_t) * capacity;
-    Region *r = mmap(NULL, size_bytes, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-    ARENA_ASSERT(r != MAP_FAILED);
+    Region *r = NULL;
+    if (size_bytes < ARENA_MMAP_RESERVE) {
+        // Without overcommit the reservation can fail, fall back to the size asked for
+        r = map_region(ARENA_MMAP_RESERVE);
+        if (r != NULL) capacity = (ARENA_MMAP_RESERVE - sizeof(Region))/sizeof(uintptr_t);
+    }
+    if (r == NULL) r = map_region(size_bytes);
+    // Checked in release builds too, ARENA_ASSERT may compile to nothing
+    if (r == NULL) {
+        perror("Failed to allocate memory.");
+        exit(1);
+    }
     r->next = NULL;
     r->count = 0;
     r->capacity = capacity;
@@ -184,8 +245,10 @@ Region *new_region(size_t capacity)
 void free_region(Region *r)
 {
     size_t size_bytes = sizeof(Region) + sizeof(uintptr_t) * r->capacity;
-    int ret = munmap(r, size_bytes);
-    ARENA_ASSERT(ret == 0);
+    if (munmap(r, size_bytes) != 0) {
+        perror("Failed to free memory.");
+        exit(1);
+    }
 }
 
 #elif ARENA_BACKEND == ARENA_BACKEND_WIN32_VIRTUALALLOC
@@ -285,11 +348,18 @@ void free_region(Region *r)
 #  error "Unknown Arena backend"
 #endif
 
-// TODO: add debug statistic collection mode for arena
-// Should collect things like:
-// - How many times new_region was called
-// - How many times existing region was skipped
-// - How many times allocation exceeded ARENA_REGION_DEFAULT_CAPACITY
+static void arena_stats_grow(Arena *a, size_t requested, size_t words)
+{
+    a->stats.requested += requested;
+    a->stats.used += words*sizeof(uintptr_t);
+    if (a->stats.used > a->stats.peak) a->stats.peak = a->stats.used;
+}
+
+static void arena_stats_region(Arena *a, size_t capacity)
+{
+    a->stats.regions += 1;
+    a->stats.reserved += sizeof(Region) + capacity*sizeof(uintptr_t);
+}
 
 void *arena_alloc(Arena *a, size_t size_bytes)
 {
@@ -301,28 +371,46 @@ void *arena_alloc(Arena *a, size_t size_bytes)
         if (capacity < size) capacity = size;
         a->end = new_region(capacity);
         a->begin = a->end;
+        arena_stats_region(a, a->end->capacity);
     }
+    if (size > ARENA_REGION_DEFAULT_CAPACITY) a->stats.oversized += 1;
 
     while (a->end->count + size > a->end->capacity && a->end->next != NULL) {
         a->end = a->end->next;
+        a->stats.skipped += 1;
     }
 
     if (a->end->count + size > a->end->capacity) {
         ARENA_ASSERT(a->end->next == NULL);
-        size_t capacity = ARENA_REGION_DEFAULT_CAPACITY;
+        size_t capacity = a->end->capacity < ARENA_REGION_MAX_CAPACITY/2 ? a->end->capacity*2 : ARENA_REGION_MAX_CAPACITY;
+        if (capacity < ARENA_REGION_DEFAULT_CAPACITY) capacity = ARENA_REGION_DEFAULT_CAPACITY;
         if (capacity < size) capacity = size;
         a->end->next = new_region(capacity);
         a->end = a->end->next;
+        arena_stats_region(a, a->end->capacity);
     }
 
     void *result = &a->end->data[a->end->count];
     a->end->count += size;
+    arena_stats_grow(a, size_bytes, size);
     return result;
 }
 
 void *arena_realloc(Arena *a, void *oldptr, size_t oldsz, size_t newsz)
 {
     if (newsz <= oldsz) return oldptr;
+
+    // The last allocation of the current region can grow in place
+    size_t oldsize = (oldsz + sizeof(uintptr_t) - 1)/sizeof(uintptr_t);
+    size_t newsize = (newsz + sizeof(uintptr_t) - 1)/sizeof(uintptr_t);
+    if (oldptr != NULL && a->end != NULL &&
+        (uintptr_t*)oldptr + oldsize == &a->end->data[a->end->count] &&
+        a->end->count - oldsize + newsize <= a->end->capacity) {
+        a->end->count += newsize - oldsize;
+        arena_stats_grow(a, newsz - oldsz, newsize - oldsize);
+        return oldptr;
+    }
+
     void *newptr = arena_alloc(a, newsz);
     char *newptr_char = (char*)newptr;
     char *oldptr_char = (char*)oldptr;
@@ -409,6 +497,7 @@ void arena_reset(Arena *a)
     }
 
     a->end = a->begin;
+    a->stats.used = 0;
 }
 
 void arena_rewind(Arena *a, Arena_Mark m)
@@ -424,6 +513,10 @@ void arena_rewind(Arena *a, Arena_Mark m)
     }
 
     a->end = m.region;
+    a->stats.used = 0;
+    for (Region *r = a->begin; r != m.region->next; r = r->next) {
+        a->stats.used += r->count*sizeof(uintptr_t);
+    }
 }
 
 void arena_free(Arena *a)
@@ -436,6 +529,7 @@ void arena_free(Arena *a)
     }
     a->begin = NULL;
     a->end = NULL;
+    a->stats.used = 0;
 }
 
 void arena_trim(Arena *a){
@@ -448,4 +542,26 @@ void arena_trim(Arena *a){
     a->end->next = NULL;
 }
 
-#endif // ARENA_IMPLEMENTATION
\ No newline at end of file
+void arena_stats_merge(Arena_Stats *into, const Arena_Stats *from)
+{
+    into->regions += from->regions;
+    into->skipped += from->skipped;
+    into->oversized += from->oversized;
+    into->requested += from->requested;
+    into->reserved += from->reserved;
+    if (into->used + from->peak > into->peak) into->peak = into->used + from->peak;
+}
+
+void arena_stats_add(Arena_Stats *into, const Arena_Stats *from)
+{
+    into->regions += from->regions;
+    into->skipped += from->skipped;
+    into->oversized += from->oversized;
+    into->requested += from->requested;
+    into->reserved += from->reserved;
+    into->used += from->used;
+    if (from->peak > into->peak) into->peak = from->peak;
+    if (into->used > into->peak) into->peak = into->used;
+}
+
+#endif // ARENA_IMPLEMENTATION
@@ -33,14 +33,16 @@ typedef struct Register
     bool free;
 } Register;
 
+DEFINE_VEC(RegisterVec, Register)
+
 typedef struct RISCV
 {
     // Temporary registers
-    Vector *temp;
+    RegisterVec temp;
     // Argument registers
-    Vector *arg;
+    RegisterVec arg;
     // Saved register
-    Vector *save;
+    RegisterVec save;
     // Return register
     Register *ret;
     // Stack Pointer
@@ -71,11 +73,11 @@ Register *emit_reg_div(Register *, Register *reg2, RISCV *_asm);
 
 Register *emit_load_register(Register *reg, int value, RISCV *_asm);
 
-Register *eval_asm(AstNode *node, RISCV *_asm);
+Register *eval_asm(AstPool *ast, AstRef node, RISCV *_asm);
 
-void gen_asm(Vector *prog);
+void gen_asm(AstPool *ast, const char *out_name);
 
-void _gen_asm(AstNode *node, RISCV *_asm);
+void _gen_asm(AstPool *ast, AstRef node, RISCV *_asm);
 
 RISCV *make_riscv(void);
 
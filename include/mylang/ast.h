@@ -3,6 +3,7 @@
 #include "hashmap.h"
 #include "lex.h"
 #include "util.h"
+#include <stdint.h>
 
 typedef enum AstNodeType
 {
@@ -24,21 +25,24 @@ typedef enum AstNodeType
     AST_EMPTY_EXPR,
     AST_EXPR_STMT,
     AST_UNARY_EXPR,
-    AST_LVAL
+    AST_LVAL,
+    AST_PARAM
 } AstNodeType;
 
-typedef struct Param
-{
-    char *value;
-    char *type;
-    SymTabEntry *symbol;
-} Param;
+// The AST of a program lives in one AstPool. Nodes are stored in a
+// single array and refer to each other by index, so a pass walks one
+// allocation instead of chasing a pointer per node and payload, and the
+// whole tree can be written out or copied as plain arrays.
 
-typedef struct AstNode
-{
-    AstNodeType type;
-    void *as;
-} AstNode;
+// Index of a node in AstPool.nodes, AST_NONE for a missing child
+typedef uint32_t AstRef;
+// Index of an interned name in AstPool.names
+typedef uint32_t AstName;
+// Index into AstPool.extra: the item count followed by the items
+typedef uint32_t AstList;
+
+// Slot 0 of every pool is a placeholder, so 0 can stand for no node
+#define AST_NONE 0
 
 typedef enum AstLValueKind
 {
@@ -48,17 +52,13 @@ typedef enum AstLValueKind
 typedef struct AstLValue
 {
     AstLValueKind kind;
-    union {
-        AstNode *ident;
-
-    } u;
-
+    AstRef ident;
 } AstLValue;
 
 typedef struct AstCompStmt
 {
-    // List of AstNode Statements
-    Vector *body;
+    // Statement nodes
+    AstList body;
 } AstCompStmt;
 
 typedef struct AstIntConst
@@ -68,148 +68,254 @@ typedef struct AstIntConst
 
 typedef struct AstBinExp
 {
-    char *value;
     TokenType op_type;
-    struct AstNode *left;
-    struct AstNode *right;
+    AstRef left;
+    AstRef right;
 } AstBinExp;
 
 typedef struct AstFuncDef
 {
-    char *value;
-    char *type;
-    AstNode *body;
-    Vector *params;
-    SymTabEntry *symbol;
+    AstName name;
+    AstName type;
+    // extra[0] is the AstList of AST_PARAM nodes, extra[1] the body
+    uint32_t extra;
 } AstFuncDef;
 
-typedef struct AstIdent
+typedef struct AstParam
 {
-    char *value;
+    AstName name;
+    AstName type;
+} AstParam;
 
-    SymTabEntry *symbol;
+typedef struct AstIdent
+{
+    AstName name;
 } AstIdent;
 
 typedef struct AstRet
 {
-    AstNode *expr;
-    SymTabEntry *func;
+    AstRef expr;
 } AstRet;
 
 typedef struct AstFuncCall
 {
-    char *value;
-    Vector *args;
-    SymTabEntry *symbol;
+    AstName name;
+    // Argument expression nodes
+    AstList args;
 } AstFuncCall;
 
 typedef struct AstVarDef
 {
-    char *value;
-    char *type;
-    AstNode *expr;
-    SymTabEntry *symbol;
+    AstName name;
+    AstName type;
+    AstRef expr;
 } AstVarDef;
 
 typedef struct AstVarDec
 {
-    char *value;
-    char *type;
-    SymTabEntry *symbol;
+    AstName name;
+    AstName type;
 } AstVarDec;
 
 typedef struct AstVarAsgn
 {
-    AstNode *lval;
-    AstNode *rval;
-    // SymTabEntry *symbol;
+    AstRef lval;
+    AstRef rval;
 } AstVarAsgn;
 
 typedef struct AstIfElse
 {
-    AstNode *if_expr;
-    AstNode *if_body;
-    AstNode *else_body;
+    AstRef if_expr;
+    AstRef if_body;
+    AstRef else_body;
 } AstIfElse;
 
 typedef struct AstEnum
 {
-    char *value;
-    Vector *enums;
+    AstName name;
+    // AstName of every enumerator
+    AstList enums;
 } AstEnum;
 
 typedef struct AstWhile
 {
-    AstNode *expr;
-    AstNode *body;
+    AstRef expr;
+    AstRef body;
 } AstWhile;
 
 typedef struct AstFor
 {
-    AstNode *init;
-    AstNode *cond;
-    AstNode *step;
-    AstNode *body;
+    AstRef init;
+    AstRef cond;
+    // extra[0] is the step, extra[1] the body
+    uint32_t extra;
 } AstFor;
 
 typedef struct AstExprStmt
 {
-    AstNode *expr;
+    AstRef expr;
 } AstExprStmt;
 
 typedef struct AstUnaryExpr
 {
-    AstNode *postfix_expr;
-    char *value;
     TokenType op_type;
+    AstRef postfix_expr;
 } AstUnaryExpr;
 
-void dump_ast(Vector *tree);
+// 16 bytes, the payload is picked by type
+typedef struct AstNode
+{
+    AstNodeType type;
+    union {
+        AstLValue lval;
+        AstCompStmt comp_stmt;
+        AstIntConst int_const;
+        AstBinExp bin_exp;
+        AstFuncDef func_def;
+        AstParam param;
+        AstIdent ident;
+        AstRet ret;
+        AstFuncCall func_call;
+        AstVarDef var_def;
+        AstVarDec var_dec;
+        AstVarAsgn var_asgn;
+        AstIfElse if_else;
+        AstEnum enm;
+        AstWhile w_stmt;
+        AstFor f_stmt;
+        AstExprStmt expr_stmt;
+        AstUnaryExpr unary_expr;
+    } as;
+} AstNode;
+
+typedef struct AstPool
+{
+    // Arena all arrays are grown in
+    Arena *arena;
+    struct
+    {
+        AstNode *items;
+        size_t count;
+        size_t capacity;
+    } nodes;
+    // Interned names, one entry per use
+    struct
+    {
+        char **items;
+        size_t count;
+        size_t capacity;
+    } names;
+    // Lists and the children that do not fit in a node
+    struct
+    {
+        uint32_t *items;
+        size_t count;
+        size_t capacity;
+    } extra;
+    // Lists under construction, nested lists are stacked on top
+    struct
+    {
+        uint32_t *items;
+        size_t count;
+        size_t capacity;
+    } scratch;
+    // Function definitions of the program
+    AstList funcs;
+    // Set by sema, the symbol each node refers to or defines, by node index
+    SymTabEntry **symbols;
+    // Set when nodes and extra live in a cache file mapping, released by
+    // ast_cache_close()
+    void *mapping;
+    size_t mapping_size;
+} AstPool;
+
+// Where the nodes, names and lists of a pool start once it is copied
+// into a bigger one. Its placeholder node and empty list are not copied.
+typedef struct AstOffsets
+{
+    uint32_t nodes;
+    uint32_t names;
+    uint32_t extra;
+} AstOffsets;
+
+AstPool *ast_pool_new(Arena *arena);
+
+void ast_pool_reserve(AstPool *ast, size_t tokens);
+
+void ast_pool_reserve_items(AstPool *ast, size_t nodes, size_t names, size_t extra);
+
+void ast_pool_copy(AstPool *into, const AstPool *from, AstOffsets at);
+
+AstRef ast_rebase_ref(AstRef ref, AstOffsets at);
+
+bool ast_pool_valid(const AstPool *ast);
+
+AstNode *ast_node(const AstPool *ast, AstRef ref);
+
+char *ast_name(const AstPool *ast, AstName name);
+
+SymTabEntry *ast_symbol(const AstPool *ast, AstRef ref);
+
+size_t ast_list_count(const AstPool *ast, AstList list);
+
+uint32_t ast_list_get(const AstPool *ast, AstList list, size_t i);
+
+size_t ast_list_begin(AstPool *ast);
+
+void ast_list_push(AstPool *ast, uint32_t item);
+
+AstList ast_list_end(AstPool *ast, size_t mark);
+
+AstName ast_add_name(AstPool *ast, char *name);
+
+AstList ast_func_params(const AstPool *ast, const AstFuncDef *func_def);
+
+AstRef ast_func_body(const AstPool *ast, const AstFuncDef *func_def);
 
-void visit(AstNode *node);
+AstRef ast_for_step(const AstPool *ast, const AstFor *f_stmt);
 
-void ast_free(AstNode *root);
+AstRef ast_for_body(const AstPool *ast, const AstFor *f_stmt);
 
-int ast_eval(AstNode *node);
+void dump_ast(AstPool *ast);
 
-struct AstNode *make_ast_node(AstNodeType type, void *inner);
+AstRef make_ast_comp_stmt(AstPool *ast, AstList body);
 
-AstNode *make_ast_comp_stmt(Vector *body);
+AstRef make_int_const(AstPool *ast, int value);
 
-AstNode *make_int_const(int value);
+AstRef make_expr_stmt(AstPool *ast, AstRef expr);
 
-AstNode *make_expr_stmt(AstNode *expr);
+AstRef make_ast_bin_exp(AstPool *ast, TokenType op_type, AstRef left, AstRef right);
 
-AstNode *make_ast_bin_exp(char *value, TokenType op_type, AstNode *left, AstNode *right);
+AstRef make_ast_func_def(AstPool *ast, AstName name, AstName type, AstRef body, AstList params);
 
-AstNode *make_ast_func_def(char *value, char *type, AstNode *body, Vector *params);
+AstRef make_ast_param(AstPool *ast, AstName name, AstName type);
 
-AstNode *make_ast_ident(char *value);
+AstRef make_ast_ident(AstPool *ast, AstName name);
 
-AstNode *make_ast_ret(AstNode *expr);
+AstRef make_ast_ret(AstPool *ast, AstRef expr);
 
-AstNode *make_ast_func_call(char *value, Vector *args);
+AstRef make_ast_func_call(AstPool *ast, AstName name, AstList args);
 
-AstNode *make_ast_var_def(char *value, char *type, AstNode *expr);
+AstRef make_ast_var_def(AstPool *ast, AstName name, AstName type, AstRef expr);
 
-AstNode *make_ast_bool_expr(char *value, AstNode *left, AstNode *right);
+AstRef make_ast_if_else(AstPool *ast, AstRef if_expr, AstRef if_body, AstRef else_body);
 
-AstNode *make_ast_if_else(AstNode *if_expr, AstNode *if_body, AstNode *else_body);
+AstRef make_ast_enum(AstPool *ast, AstName name, AstList enums);
 
-AstNode *make_ast_enum(char *value, Vector *enums);
+AstRef make_ast_var_dec(AstPool *ast, AstName name, AstName type);
 
-AstNode *make_ast_var_dec(char *value, char *type);
+AstRef make_ast_var_asgn(AstPool *ast, AstRef lval, AstRef rval);
 
-AstNode *make_ast_var_asgn(AstNode *lval, AstNode *rval);
+AstRef make_ast_while(AstPool *ast, AstRef expr, AstRef body);
 
-AstNode *make_ast_while(AstNode *expr, AstNode *body);
+AstRef make_ast_for(AstPool *ast, AstRef init, AstRef cond, AstRef step, AstRef body);
 
-AstNode *make_ast_for(AstNode *init, AstNode *cond, AstNode *step, AstNode *body);
+AstRef make_ast_unary_expr(AstPool *ast, AstRef postfix_expr, TokenType op_type);
 
-AstNode *make_ast_unary_expr(AstNode *postfix_expr, char *value, TokenType op_type);
+AstRef make_ast_lval(AstPool *ast, AstLValueKind kind, AstRef ident);
 
-AstNode *make_ast_lval(AstLValueKind kind);
+AstRef make_ast_empty_expr(AstPool *ast);
 
-void _print_ast(AstNode *, int);
+void _print_ast(AstPool *ast, AstRef node, int level);
 
 #endif
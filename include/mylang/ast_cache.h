@@ -0,0 +1,26 @@
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+#include "ast.h"
+#include "util.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// The checked AST of a source can be written to a cache file and mapped
+// back on the next compile of the same source, skipping lexing, parsing
+// and sema. The file holds no pointers: nodes and lists are stored as
+// they are in the pool, names and symbols refer to tables by index.
+// Files are only read back by the same version of my-lang on a host with
+// the same byte order, anything else is treated as a miss.
+
+// Bumped whenever the file layout or AstNode changes
+#define AST_CACHE_FORMAT 1
+
+char *ast_cache_path(const char *dir, uint64_t source_hash);
+
+bool ast_cache_write(const char *path, AstPool *ast, SymbolVec *symbols, uint64_t source_hash, size_t source_length);
+
+AstPool *ast_cache_load(const char *path, uint64_t source_hash, size_t source_length, SymbolVec **symbols);
+
+void ast_cache_close(AstPool *ast);
+
+#endif
@@ -43,6 +43,7 @@ typedef struct TypeEnvEntry
 
 typedef struct SymTabEntry
 {
+    // Interned name of the symbol
     char *key;
     SymbolType symbol;
 
@@ -55,8 +56,8 @@ typedef struct SymTabEntry
     // Variable location, offset from sp in bytes
     size_t offset;
 
-    // Function param types (char*)
-    Vector *params;
+    // Number of function params
+    size_t param_count;
 
     // Value for enum
     int const_value;
@@ -66,6 +67,8 @@ typedef struct SymTabEntry
     bool is_used;
 } SymTabEntry;
 
+DEFINE_VEC(SymbolVec, SymTabEntry *)
+
 typedef struct TableNode
 {
     void *data;
@@ -78,15 +81,19 @@ typedef struct HashMap
 {
     size_t size;
     struct TableNode **table;
+    // Keys are interned names, compared by pointer and hashed once
+    bool interned;
 } HashMap;
 
 SymTabEntry *make_symtab_entry(char *key, TypeSpecifier type, SymbolType symbol);
 
 TableNode *make_table_node(TableNode *next, void *data, char *key);
 
-void *find(TableNode *node, char *key);
+uint64_t hash_bytes(const char *data, size_t length);
+
+void *find(HashMap *map, TableNode *node, char *key);
 
-void insert(TableNode **node, void *entry, char *key);
+void insert(HashMap *map, TableNode **node, void *entry, char *key);
 
 void hashmap_add(HashMap *map, void *entry, char *key);
 
@@ -94,6 +101,8 @@ void *hashmap_get(HashMap *map, char *key);
 
 HashMap *hashmap_new(void);
 
+HashMap *hashmap_new_interned(void);
+
 void hashmap_free(HashMap *table);
 
 void type_env_free(HashMap *table);
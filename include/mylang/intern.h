@@ -0,0 +1,39 @@
+#ifndef INTERN_H
+#define INTERN_H
+#include "arena.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Every distinct identifier is stored once. Interning the same text
+// twice returns the same pointer, so interned names can be compared
+// with == and their hash is read back instead of recomputed.
+typedef struct InternTable
+{
+    // Owns the strings, outlives the arenas of the compiler phases
+    Arena arena;
+    struct InternEntry **buckets;
+    size_t size;
+    size_t count;
+} InternTable;
+
+extern InternTable default_interns;
+// Per thread like context_arena, starts out as default_interns
+extern __thread InternTable *context_interns;
+
+char *intern(InternTable *table, const char *str, size_t length);
+
+char *intern_cstr(InternTable *table, const char *str);
+
+// Only valid for pointers returned by intern()
+uint64_t intern_hash(const char *name);
+
+size_t intern_length(const char *name);
+
+// Used to combine tables filled by different threads
+void intern_merge(InternTable *into, InternTable *from);
+
+char *intern_resolve(const char *name);
+
+void intern_free(InternTable *table);
+
+#endif
@@ -1,17 +1,25 @@
 #ifndef LEX_H
 #define LEX_H
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
 #include "hashmap.h"
+#include "intern.h"
+#include "scan.h"
+#include "source.h"
 #include "util.h"
 
 typedef struct Lexer
 {
     const char *input;
-    int curr;
-    int length;
+    size_t curr;
+    size_t length;
+    // SIMD or scalar kernels picked for this CPU
+    const ScanKernels *scan;
+    // Table identifiers are interned into
+    InternTable *interns;
 } Lexer;
 
 typedef enum TokenType
@@ -52,40 +60,119 @@ typedef enum TokenType
     TOK_LT,
     TOK_GT_EQ,
     TOK_LT_EQ,
+    // Never produced by the lexer, returned when reading past the last token
+    TOK_EOF,
 } TokenType;
 
+// Integer suffixes of a TOK_NUM, C allows 'u' together with 'l' or 'll'
+typedef enum NumSuffix
+{
+    NUM_UNSIGNED = 1 << 0,
+    NUM_LONG = 1 << 1,
+    NUM_LONG_LONG = 1 << 2,
+} NumSuffix;
+
+// Tokens do not own their text, they are a view into
+// the source buffer the lexer was run over
 typedef struct Token
 {
     TokenType type;
-    String *value;
-    int pos;
-    int line;
+    // Byte offset of the first character in the source
+    size_t offset;
+    // Length of the lexeme in bytes
+    size_t length;
+    // Interned text of identifiers and type names, NULL otherwise
+    char *ident;
+    // Value and NumSuffix flags of TOK_NUM, set by the lexer
+    uint64_t value;
+    unsigned char suffix;
 } Token;
 
-void dump_tokens(Vector* tokens);
+typedef union TokenValue
+{
+    char *ident;
+    uint64_t value;
+} TokenValue;
+
+// Tokens of a source as parallel arrays. Walking the token types
+// reads one byte per token instead of a pointer and a whole Token.
+typedef struct TokenBuffer
+{
+    // Arena the arrays are allocated and grown in
+    Arena *arena;
+    const char *input;
+    size_t input_length;
+    size_t count;
+    size_t capacity;
+    uint8_t *types;
+    uint32_t *offsets;
+    uint32_t *lengths;
+    // Token.value for TOK_NUM, Token.ident for everything else
+    TokenValue *values;
+    uint8_t *suffixes;
+} TokenBuffer;
+
+TokenBuffer *token_buffer_new(const char *input, size_t input_length, size_t capacity);
+
+TokenBuffer *token_buffer_new_in(Arena *arena, const char *input, size_t input_length, size_t capacity);
+
+void token_buffer_set(TokenBuffer *tokens, size_t index, const Token *token);
+
+void token_buffer_push(TokenBuffer *tokens, const Token *token);
+
+void token_buffer_reserve(TokenBuffer *tokens, size_t capacity);
 
-void print_token(Token *t);
+Token token_at(const TokenBuffer *tokens, size_t index);
 
-Token *make_token(int type, String *value, int pos, int line);
+void dump_tokens(TokenBuffer *tokens);
 
-int is_operator(char c);
+void print_token(const char *input, Token *t, SourcePos pos);
 
-char next(Lexer *Lexer);
+Token *make_token(int type, size_t offset, size_t length);
 
-void tokenize_digit(char c, Token *token, Lexer *lexer);
+const char *token_spelling(TokenType type);
 
-int is_ident_start(char c);
+char *token_str(const char *input, Token *t);
 
-int is_ident_char(char c);
+// Keywords are found with one probe of a table indexed by
+// their length and first and last byte
+#define KEYWORD_TABLE_SIZE 128
+#define KEYWORD_HASH(length, first, last) (((length) + (first) * 10 + (last) * 3) & (KEYWORD_TABLE_SIZE - 1))
 
-void tokenize_ident(char c, Token *token, Lexer *lexer);
+TokenType keyword_lookup(const char *ident, size_t length);
+
+void lexer_init(Lexer *lexer, const char *input, size_t length);
+
+bool lex_token(Lexer *lexer, Token *token);
+
+void tokenize_operator(Lexer *lexer, Token *token);
+
+void tokenize_digit(Lexer *lexer, Token *token);
+
+void tokenize_ident(Lexer *lexer, Token *token);
 
 char *read_file(char *file_name, size_t *length);
 
-Vector *tokenize(const char *input, size_t input_length);
+TokenBuffer *tokenize(const char *input, size_t input_length);
+
+// Inputs are only split into chunks of at least this many bytes
+#define LEX_CHUNK_MIN (1 << 20)
+
+int lex_chunk_count(size_t input_length, int jobs);
+
+TokenBuffer *tokenize_parallel(const char *input, size_t input_length, int jobs);
+
+// An edit of the text a TokenBuffer was lexed from. Bytes [start, old_end)
+// of the old text were replaced, the replacement is [start, new_end) of the new one.
+typedef struct TextEdit
+{
+    size_t start;
+    size_t old_end;
+    size_t new_end;
+} TextEdit;
 
-void back(Lexer *lexer);
+size_t token_buffer_edit(TokenBuffer *tokens, const char *input, size_t input_length, TextEdit edit);
 
-void free_tokens(Vector *tokens);
+void free_tokens(TokenBuffer *tokens);
 
 #endif
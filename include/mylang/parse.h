@@ -5,35 +5,74 @@
 #include "lex.h"
 #include "util.h"
 
+// Tokens the parser looks ahead of the current one at most
+#define TOKEN_LOOKAHEAD 3
+
+// Tokens kept by a lexer backed stream, a Token pointer handed out
+// stays valid for TOKEN_RING_SIZE - TOKEN_LOOKAHEAD calls to next_token
+#define TOKEN_RING_SIZE 8
+
+// Rough size of a token including blanks, used to size
+// the AST before the tokens of a source are known
+#define SOURCE_BYTES_PER_TOKEN 6
+
+// Token lists are only split into chunks of at least this many tokens
+#define PARSE_CHUNK_MIN (1 << 16)
+
 typedef struct TokenStream
 {
-    Vector *tokens;
+    // Source buffer the tokens point into
+    const char *input;
+    // Whole token list, or a TOKEN_RING_SIZE ring for a lexer backed stream
+    TokenBuffer *tokens;
     size_t current;
+    // Tokens before this index have been lexed
+    size_t end;
+    // Token i is kept in slot i & mask of tokens
+    size_t mask;
+
+    // Lexer backed streams pull tokens on demand, NULL otherwise
+    Lexer *lexer;
+    // Tokens returned by peek() are unpacked here
+    Token view[TOKEN_RING_SIZE];
+
+    // Pool the parsed nodes are added to
+    AstPool *ast;
 } TokenStream;
 
-AstNode *parse_expression(TokenStream *stream);
+AstRef parse_expression(TokenStream *stream);
+
+AstRef parse_statement(TokenStream *stream);
+
+AstRef parse_factor(TokenStream *stream);
+
+AstRef parse_term(TokenStream *stream);
 
-AstNode *parse_statement(TokenStream *stream);
+AstPool *parse(TokenBuffer *tokens);
 
-AstNode *parse_factor(TokenStream *stream);
+AstPool *parse_source(const char *input, size_t length);
 
-AstNode *parse_term(TokenStream *stream);
+int parse_chunk_count(size_t tokens, int jobs);
 
-Vector *parse(Vector *tokens);
+AstPool *parse_parallel(TokenBuffer *tokens, int jobs);
 
-AstNode *parse_var_def(TokenStream *stream);
+AstRef parse_var_def(TokenStream *stream);
 
-AstNode *parse_func_def(TokenStream *stream);
+AstRef parse_func_def(TokenStream *stream);
 
 Token *current_token(TokenStream *stream);
 
-AstNode *parse_var_dec(TokenStream *stream);
+TokenType current_type(TokenStream *stream);
 
-AstNode *parse_var_asgn(TokenStream *stream);
+TokenType peek_type(TokenStream *stream, int n);
 
-AstNode *parse_func_call(TokenStream *stream);
+AstRef parse_var_dec(TokenStream *stream);
 
-AstNode *parse_declartion(TokenStream *stream);
+AstRef parse_var_asgn(TokenStream *stream);
+
+AstRef parse_func_call(TokenStream *stream);
+
+AstRef parse_declartion(TokenStream *stream);
 
 int is_func_call_start(TokenStream *stream);
 
@@ -43,5 +82,15 @@ bool is_var_asgn(TokenStream *stream);
 
 bool is_declartion(TokenStream *stream);
 
-TokenStream *make_token_stream(Vector *tokens);
+void token_stream_init(TokenStream *stream, TokenBuffer *tokens, AstPool *ast);
+
+TokenStream *make_token_stream(TokenBuffer *tokens);
+
+TokenStream *make_lexer_stream(Lexer *lexer);
+
+char *token_text(TokenStream *stream, Token *token);
+
+char *token_name(TokenStream *stream, Token *token);
+
+SourcePos token_pos(TokenStream *stream, Token *token);
 #endif
@@ -0,0 +1,37 @@
+#ifndef SCAN_H
+#define SCAN_H
+#include <stddef.h>
+
+// Instruction sets the scanning kernels are built for
+typedef enum ScanIsa
+{
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+} ScanIsa;
+
+// Kernels that find the end of long runs of bytes in the source.
+// All of them start at index 'i' and never read at or past 'length'.
+typedef struct ScanKernels
+{
+    ScanIsa isa;
+    const char *name;
+
+    // Skip ' ', '\t' and '\n'
+    size_t (*blank)(const char *input, size_t i, size_t length);
+
+    // Index of the next '\n', or length if there is none
+    size_t (*line_end)(const char *input, size_t i, size_t length);
+
+    // Index of the next "*/", or length if there is none
+    size_t (*comment_end)(const char *input, size_t i, size_t length);
+
+    // End of a run of [A-Za-z0-9_]
+    size_t (*ident)(const char *input, size_t i, size_t length);
+} ScanKernels;
+
+const ScanKernels *scan_kernels(void);
+
+const ScanKernels *scan_kernels_for(ScanIsa isa);
+
+#endif
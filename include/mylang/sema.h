@@ -12,10 +12,15 @@ struct Scope
     Scope *parent;
     HashMap *symtab;
     int id;
+    // Scopes are dead once sema is done, they are allocated in a scratch
+    // arena of their own instead of the context arena
+    Arena *arena;
 };
 
-void sym_check(AstNode *node, StackFrame *frame, Scope *scope, HashMap *type_env, Vector *symbols);
+void sym_check(AstPool *ast, AstRef node, StackFrame *frame, Scope *scope, HashMap *type_env, SymbolVec *symbols);
 
-Vector *sema_check(Vector *prog, HashMap *type_env);
+SymbolVec *sema_check(AstPool *ast, HashMap *type_env);
+
+void warn_unused(SymbolVec *symbols);
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// Source text handed to the lexer. Regular files are mapped read-only,
+// pipes and stdin are copied into the context arena. The data is not
+// NUL-terminated.
+typedef struct Source
+{
+    const char *data;
+    size_t length;
+    // Set when data is a file mapping that source_close() has to unmap
+    bool mapped;
+} Source;
+
+// Line and column of a byte offset, both counted from 1
+typedef struct SourcePos
+{
+    int line;
+    int column;
+} SourcePos;
+
+// Offset of the first byte of every line. Tokens only record their
+// offset, this maps it back to a line and column for diagnostics.
+typedef struct LineIndex
+{
+    size_t *starts;
+    size_t count;
+} LineIndex;
+
+bool source_open(Source *source, const char *file_name);
+
+void source_close(Source *source);
+
+LineIndex *line_index_new(const char *input, size_t length);
+
+SourcePos line_index_lookup(const LineIndex *index, size_t offset);
+
+SourcePos source_pos(const char *input, size_t length, size_t offset);
+
+#endif
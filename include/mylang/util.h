@@ -1,10 +1,12 @@
 #ifndef UTIL_H
 #define UTIL_H
 #include "mylang/arena.h"
+#include <assert.h>
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #define COLOR_RESET   "\x1b[0m"
@@ -15,7 +17,52 @@
 
 
 extern Arena default_arena;
-extern Arena *context_arena;
+// Per thread, so files compiled on different threads allocate from
+// arenas of their own. Starts out as default_arena, except on threads
+// started by run_parallel(), which have no context.
+extern __thread Arena *context_arena;
+// Where warnings of the compilation running on this thread go, NULL
+// for stdout
+extern __thread FILE *context_diagnostics;
+
+// What the library reaches through the context_* variables. Each
+// compilation runs in a context of its own, so compilations on different
+// threads share nothing and need no locks.
+typedef struct Context
+{
+    Arena *arena;
+    struct InternTable *interns;
+    FILE *diagnostics;
+} Context;
+
+// Make ctx the context of the calling thread, returns the one it replaces
+Context context_swap(Context ctx);
+
+// Print a warning of the compilation running on this thread
+void diagnostic(const char *format, ...);
+
+// Declares 'name', a dynamic array storing T by value. It has the layout
+// arena_da_append() expects, name_push() grows it in the context arena.
+// name_at() is bounds checked unless NDEBUG is set, hot loops can index
+// items directly.
+#define DEFINE_VEC(name, T)                                                                                            \
+    typedef struct name                                                                                                \
+    {                                                                                                                  \
+        T *items;                                                                                                      \
+        size_t count;                                                                                                  \
+        size_t capacity;                                                                                               \
+    } name;                                                                                                            \
+                                                                                                                       \
+    static inline void name##_push(name *vec, T item)                                                                  \
+    {                                                                                                                  \
+        arena_da_append(context_arena, vec, item);                                                                     \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline T *name##_at(const name *vec, size_t i)                                                              \
+    {                                                                                                                  \
+        assert(i < vec->count);                                                                                        \
+        return &vec->items[i];                                                                                         \
+    }
 
 #ifdef DEBUG
 #define DEBUG_PRINT(x) printf x
@@ -44,10 +91,20 @@ typedef struct Vector
     size_t length;
 } Vector;
 
+// Bytes a String holds without allocating, including the NUL
+#define STRING_INLINE_SIZE 16
+
+// Contiguous, always NUL-terminated bytes. Short strings are stored in
+// the struct itself, longer ones in the context arena.
 typedef struct String
 {
-    Vector *vector;
     size_t length;
+    // Bytes that fit without growing, not counting the NUL
+    size_t capacity;
+    union {
+        char *heap;
+        char small[STRING_INLINE_SIZE];
+    } data;
 } String;
 
 char *int_to_str(int num, int size);
@@ -64,6 +121,10 @@ String *string_new(void);
 
 void string_append(String *string, char c);
 
+void string_append_many(String *string, const char *str, size_t length);
+
+char *string_data(String *string);
+
 char *as_str(String *string);
 
 void *vector_get(Vector *vector, size_t index);
@@ -82,4 +143,6 @@ char *str_clone(char *s);
 
 void *context_alloc(size_t size);
 
+void run_parallel(void *(*work)(void *), void *items, size_t size, int count);
+
 #endif
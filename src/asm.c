@@ -35,9 +35,7 @@ Register *make_register(char *label)
 RISCV *make_riscv(void)
 {
     RISCV *riscv = (RISCV *)context_alloc(sizeof(RISCV));
-    Vector *temp_reg = vector_new();
-    Vector *arg_reg = vector_new();
-    Vector *save_reg = vector_new();
+    memset(riscv, 0, sizeof(RISCV));
 
     // Temp registers
     char *temp[7] = {"t0", "t1", "t2", "t3", "t4", "t5", "t6"};
@@ -45,28 +43,19 @@ RISCV *make_riscv(void)
     char *save[12] = {"s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"};
     for (int i = 0; i < 7; i++)
     {
-        vector_push(temp_reg, make_register(temp[i]));
+        RegisterVec_push(&riscv->temp, (Register){temp[i], true});
     }
     for (int i = 0; i < 8; i++)
     {
-        vector_push(arg_reg, make_register(arg[i]));
+        RegisterVec_push(&riscv->arg, (Register){arg[i], true});
     }
     for (int i = 0; i < 12; i++)
     {
-        vector_push(save_reg, make_register(save[i]));
+        RegisterVec_push(&riscv->save, (Register){save[i], true});
     }
-    riscv->temp = temp_reg;
-    riscv->arg = arg_reg;
-    riscv->save = save_reg;
     riscv->ret = make_register("ra");
     riscv->sp = make_register("sp");
     riscv->zero = make_register("zero");
-    riscv->while_count = 0;
-    riscv->for_count = 0;
-    riscv->if_count = 0;
-    riscv->else_count = 0;
-    riscv->and_count = 0;
-    riscv->or_count = 0;
     return riscv;
 }
 
@@ -228,9 +217,9 @@ void emit_add_imm(Register *rd, Register *reg1, int imm, RISCV *_asm)
 // Allocate free temporary register
 Register *alloc_register(RISCV *_asm)
 {
-    for (size_t i = 0; i < _asm->temp->length; i++)
+    for (size_t i = 0; i < _asm->temp.count; i++)
     {
-        Register *reg = vector_get(_asm->temp, i);
+        Register *reg = &_asm->temp.items[i];
         if (reg->free)
         {
             reg->free = false;
@@ -311,22 +300,22 @@ void emit_move_register(Register *reg1, Register *reg2, RISCV *_asm)
     fprintf(_asm->out, "\tmv %s, %s\n", reg2->label, reg1->label);
 }
 
-Register *eval_func_call(AstNode *node, RISCV *_asm)
+Register *eval_func_call(AstPool *ast, AstRef node, RISCV *_asm)
 {
     AstFuncCall *func_call;
     Register *ret_reg;
     Register *reg;
 
-    func_call = (AstFuncCall *)node->as;
+    func_call = &ast_node(ast, node)->as.func_call;
 
-    size_t base_offset = func_call->symbol->frame->size + (REGISTER_SIZE * (3 + _asm->arg->length));
+    size_t base_offset = ast_symbol(ast, node)->frame->size + (REGISTER_SIZE * (3 + _asm->arg.count));
 
     size_t temp_offset = base_offset;
     int freed[7] = {0};
     emit_comment("Function Call", _asm);
-    for (size_t i = 0; i < _asm->temp->length; i++)
+    for (size_t i = 0; i < _asm->temp.count; i++)
     {
-        reg = vector_get(_asm->temp, i);
+        reg = &_asm->temp.items[i];
         if (!reg->free)
         {
             temp_offset += REGISTER_SIZE;
@@ -339,10 +328,10 @@ Register *eval_func_call(AstNode *node, RISCV *_asm)
     emit_comment("Evaluate Args", _asm);
     // Evaluate arguments and store in spill section
     size_t arg_offset = temp_offset;
-    for (size_t i = 0; i < func_call->args->length; i++)
+    for (size_t i = 0; i < ast_list_count(ast, func_call->args); i++)
     {
-        AstNode *arg = (AstNode *)vector_get(func_call->args, i);
-        reg = eval_asm(arg, _asm);
+        AstRef arg = ast_list_get(ast, func_call->args, i);
+        reg = eval_asm(ast, arg, _asm);
 
         arg_offset += REGISTER_SIZE;
         emit_store_word_fp(reg, arg_offset, _asm);
@@ -353,22 +342,22 @@ Register *eval_func_call(AstNode *node, RISCV *_asm)
     emit_comment("Move Evaluated Args to Registers", _asm);
     // Move spilled arguments into argument registers
     size_t load_offset = temp_offset;
-    for (size_t i = 0; i < func_call->args->length && i < _asm->arg->length; i++)
+    for (size_t i = 0; i < ast_list_count(ast, func_call->args) && i < _asm->arg.count; i++)
     {
         load_offset += REGISTER_SIZE;
-        emit_load_word_fp(((Register *)vector_get(_asm->arg, i)), load_offset, _asm);
+        emit_load_word_fp(&_asm->arg.items[i], load_offset, _asm);
     }
 
     // TODO move left over args to stack
 
-    emit_jump_to_label(func_call->value, _asm);
+    emit_jump_to_label(ast_name(ast, func_call->name), _asm);
 
     // Restore temp registers
-    for (int i = _asm->temp->length - 1; i >= 0; i--)
+    for (int i = (int)_asm->temp.count - 1; i >= 0; i--)
     {
         if (freed[i])
         {
-            reg = vector_get(_asm->temp, i);
+            reg = &_asm->temp.items[i];
             emit_load_word_fp(reg, temp_offset, _asm);
             temp_offset -= REGISTER_SIZE;
             reg->free = false;
@@ -377,7 +366,7 @@ Register *eval_func_call(AstNode *node, RISCV *_asm)
 
     // Move return value to empty register
     reg = alloc_register(_asm);
-    ret_reg = (Register *)vector_get(_asm->arg, 0);
+    ret_reg = RegisterVec_at(&_asm->arg, 0);
 
     emit_move_register(ret_reg, reg, _asm);
 
@@ -434,7 +423,7 @@ Register *eval_log_or(Register *left, Register *right, RISCV *_asm)
     return reg;
 }
 
-Register *eval_bin_exp(AstNode *node, RISCV *_asm)
+Register *eval_bin_exp(AstPool *ast, AstRef node, RISCV *_asm)
 {
     AstBinExp *bin_exp;
     Register *left;
@@ -442,9 +431,9 @@ Register *eval_bin_exp(AstNode *node, RISCV *_asm)
     Register *reg;
     Register *tmp;
 
-    bin_exp = (AstBinExp *)node->as;
-    left = eval_asm(bin_exp->left, _asm);
-    right = eval_asm(bin_exp->right, _asm);
+    bin_exp = &ast_node(ast, node)->as.bin_exp;
+    left = eval_asm(ast, bin_exp->left, _asm);
+    right = eval_asm(ast, bin_exp->right, _asm);
     switch (bin_exp->op_type)
     {
     case TOK_ADD:
@@ -572,54 +561,54 @@ Register *eval_bin_exp(AstNode *node, RISCV *_asm)
     }
 }
 
-void gen_if(AstNode *node, RISCV *_asm)
+void gen_if(AstPool *ast, AstRef node, RISCV *_asm)
 {
     AstIfElse *if_stmt;
     Register *reg;
     Label if_label = create_base_cond_label(LBL_IF, _asm);
     Label else_label = create_base_cond_label(LBL_ELSE, _asm);
 
-    if_stmt = (AstIfElse *)node->as;
+    if_stmt = &ast_node(ast, node)->as.if_else;
     // Add label
     emit_label(if_label, _asm);
 
     // eval bool expression, reg = 0 for false and reg = 1 for true
-    reg = eval_asm(if_stmt->if_expr, _asm);
+    reg = eval_asm(ast, if_stmt->if_expr, _asm);
 
     // cmp and branch to end label
     emit_branch_eq(reg, _asm->zero, else_label, _asm);
     free_register(reg);
 
     // eval body
-    _gen_asm(if_stmt->if_body, _asm);
+    _gen_asm(ast, if_stmt->if_body, _asm);
 
     // add other label
     emit_label(else_label, _asm);
 
-    if (if_stmt->else_body != NULL)
-        _gen_asm(if_stmt->else_body, _asm);
+    if (if_stmt->else_body != AST_NONE)
+        _gen_asm(ast, if_stmt->else_body, _asm);
 }
 
-void gen_ret(AstNode *node, RISCV *_asm)
+void gen_ret(AstPool *ast, AstRef node, RISCV *_asm)
 {
     AstRet *ret;
     Register *reg;
     Register *ret_reg;
     StackFrame *frame;
-    Register *fp = (Register *)vector_get(_asm->save, 0);
+    Register *fp = RegisterVec_at(&_asm->save, 0);
 
-    ret = (AstRet *)node->as;
-    frame = ret->func->frame;
+    ret = &ast_node(ast, node)->as.ret;
+    frame = ast_symbol(ast, node)->frame;
 
     // return val
-    if (ret->expr->type == AST_EMPTY_EXPR)
-        _gen_asm(ret->expr, _asm);
+    if (ast_node(ast, ret->expr)->type == AST_EMPTY_EXPR)
+        _gen_asm(ast, ret->expr, _asm);
     else
     {
 
         emit_comment("Evaluate Return", _asm);
-        reg = eval_asm(ret->expr, _asm);
-        ret_reg = vector_get(_asm->arg, 0);
+        reg = eval_asm(ast, ret->expr, _asm);
+        ret_reg = RegisterVec_at(&_asm->arg, 0);
         // move to return a0
         emit_move_register(reg, ret_reg, _asm);
         free_register(reg);
@@ -629,7 +618,7 @@ void gen_ret(AstNode *node, RISCV *_asm)
 
     size_t frame_size = (REGISTER_SIZE * 2) +                                             // RA + FP
                         frame->size +                                                     // locals;
-                        (REGISTER_SIZE * (_asm->temp->length + (_asm->arg->length * 2))); // Temp + arg
+                        (REGISTER_SIZE * (_asm->temp.count + (_asm->arg.count * 2))); // Temp + arg
 
     frame_size = frame_size + (16 - (frame_size % 16));
 
@@ -641,52 +630,54 @@ void gen_ret(AstNode *node, RISCV *_asm)
     emit_return_from_jump(_asm);
 }
 
-void gen_comp_stmt(AstNode *node, RISCV *_asm)
+void gen_comp_stmt(AstPool *ast, AstRef node, RISCV *_asm)
 {
     AstCompStmt *comp_stmt;
-    comp_stmt = (AstCompStmt *)node->as;
+    comp_stmt = &ast_node(ast, node)->as.comp_stmt;
 
-    for (size_t i = 0; i < comp_stmt->body->length; i++)
+    for (size_t i = 0; i < ast_list_count(ast, comp_stmt->body); i++)
     {
-        AstNode *stmt = (AstNode *)vector_get(comp_stmt->body, i);
-        _gen_asm(stmt, _asm);
+        AstRef stmt = ast_list_get(ast, comp_stmt->body, i);
+        _gen_asm(ast, stmt, _asm);
     }
 }
 
-Register *eval_int_const(AstNode *node, RISCV *_asm)
+Register *eval_int_const(AstPool *ast, AstRef node, RISCV *_asm)
 {
     Register *reg;
     AstIntConst *int_node;
-    int_node = (AstIntConst *)node->as;
+    int_node = &ast_node(ast, node)->as.int_const;
 
     reg = alloc_register(_asm);
     emit_load_register(reg, int_node->value, _asm);
     return reg;
 }
 
-void gen_func_def(AstNode *node, RISCV *_asm)
+void gen_func_def(AstPool *ast, AstRef node, RISCV *_asm)
 {
     AstFuncDef *func_def;
+    AstList params;
     Register *reg;
-    Register *fp = (Register *)vector_get(_asm->save, 0);
+    Register *fp = RegisterVec_at(&_asm->save, 0);
 
-    func_def = (AstFuncDef *)node->as;
-    emit_label(func_def->value, _asm);
+    func_def = &ast_node(ast, node)->as.func_def;
+    params = ast_func_params(ast, func_def);
+    emit_label(ast_name(ast, func_def->name), _asm);
 
-    if (func_def->params->length > 8)
+    if (ast_list_count(ast, params) > 8)
     {
         perror("Max params reached");
     }
-    for (size_t i = 0; i < func_def->params->length; i++)
+    for (size_t i = 0; i < ast_list_count(ast, params); i++)
     {
-        Param *param = (Param *)vector_get(func_def->params, i);
-        param->symbol->is_arg_loaded = true;
-        param->symbol->arg_reg = i;
+        SymTabEntry *param = ast_symbol(ast, ast_list_get(ast, params, i));
+        param->is_arg_loaded = true;
+        param->arg_reg = i;
     }
 
     size_t frame_size = (REGISTER_SIZE * 2) +                                             // RA + FP
-                        func_def->symbol->frame->size +                                   // locals;
-                        (REGISTER_SIZE * (_asm->temp->length + (_asm->arg->length * 2))); // Temp + arg
+                        ast_symbol(ast, node)->frame->size +                              // locals;
+                        (REGISTER_SIZE * (_asm->temp.count + (_asm->arg.count * 2))); // Temp + arg
 
     // Align 16 bytes
 
@@ -705,17 +696,17 @@ void gen_func_def(AstNode *node, RISCV *_asm)
     emit_add_imm(fp, _asm->sp, frame_size, _asm);
 
     emit_comment("Save Arg Registers", _asm);
-    for (size_t i = 0; i < _asm->arg->length; i++)
+    for (size_t i = 0; i < _asm->arg.count; i++)
     {
-        reg = vector_get(_asm->arg, i);
+        reg = &_asm->arg.items[i];
         emit_store_word_fp(reg, arg_offset, _asm);
         arg_offset += REGISTER_SIZE;
     }
 
-    _gen_asm(func_def->body, _asm);
+    _gen_asm(ast, ast_func_body(ast, func_def), _asm);
 
     // I think this is only for non void
-    if (!strcmp("void", func_def->type))
+    if (!strcmp("void", ast_name(ast, func_def->type)))
     {
         emit_sp_load(_asm->ret, frame_size - REGISTER_SIZE, _asm);
         emit_sp_load(fp, frame_size - (REGISTER_SIZE * 2), _asm);
@@ -725,33 +716,33 @@ void gen_func_def(AstNode *node, RISCV *_asm)
     emit_return_from_jump(_asm);
 }
 
-void gen_var_def(AstNode *node, RISCV *_asm)
+void gen_var_def(AstPool *ast, AstRef node, RISCV *_asm)
 {
     size_t offset;
     AstVarDef *var_def;
+    SymTabEntry *symbol;
     Register *reg;
 
-    var_def = (AstVarDef *)node->as;
+    var_def = &ast_node(ast, node)->as.var_def;
+    symbol = ast_symbol(ast, node);
     // Increase stack frame size
-    offset = var_def->symbol->offset;
+    offset = symbol->offset;
 
-    emit_comment("Variable definition: %s", _asm, var_def->symbol->key);
-    reg = eval_asm(var_def->expr, _asm);
+    emit_comment("Variable definition: %s", _asm, symbol->key);
+    reg = eval_asm(ast, var_def->expr, _asm);
 
     // Store value relative to fp
-    emit_store_word_fp(reg, offset + (REGISTER_SIZE * (3 + _asm->arg->length)), _asm);
+    emit_store_word_fp(reg, offset + (REGISTER_SIZE * (3 + _asm->arg.count)), _asm);
     free_register(reg);
 }
 
-Register *eval_ident(AstNode *node, RISCV *_asm)
+Register *eval_ident(AstPool *ast, AstRef node, RISCV *_asm)
 {
-    AstIdent *ident_node;
     Register *reg;
     SymTabEntry *var;
 
     // Store location in symbol table
-    ident_node = (AstIdent *)node->as;
-    var = ident_node->symbol;
+    var = ast_symbol(ast, node);
 
     if (var->symbol == SYM_CONST)
     {
@@ -772,21 +763,21 @@ Register *eval_ident(AstNode *node, RISCV *_asm)
     // Load value from sp
     emit_comment("Load Value from frame: %s", _asm, var->key);
     reg = alloc_register(_asm);
-    emit_load_word_fp(reg, var->offset + (REGISTER_SIZE * (3 + _asm->arg->length)), _asm);
+    emit_load_word_fp(reg, var->offset + (REGISTER_SIZE * (3 + _asm->arg.count)), _asm);
     return reg;
 }
 
-Register *eval_var_asgn(AstNode *node, RISCV *_asm)
+Register *eval_var_asgn(AstPool *ast, AstRef node, RISCV *_asm)
 {
     AstVarAsgn *asgn;
     Register *lval;
     Register *rval;
-    Register *fp = (Register *)vector_get(_asm->save, 0);
+    Register *fp = RegisterVec_at(&_asm->save, 0);
 
-    asgn = (AstVarAsgn *)node->as;
+    asgn = &ast_node(ast, node)->as.var_asgn;
 
-    lval = eval_asm(asgn->lval, _asm);
-    rval = eval_asm(asgn->rval, _asm);
+    lval = eval_asm(ast, asgn->lval, _asm);
+    rval = eval_asm(ast, asgn->rval, _asm);
 
     // Calculate lval stack address from fp
     emit_sub(lval, fp, lval, _asm);
@@ -796,20 +787,20 @@ Register *eval_var_asgn(AstNode *node, RISCV *_asm)
     return rval;
 }
 
-Register *eval_unary_expr(AstNode *node, RISCV *_asm)
+Register *eval_unary_expr(AstPool *ast, AstRef node, RISCV *_asm)
 {
     Register *reg;
     Register *tmp;
     AstUnaryExpr *unary_expr;
 
-    unary_expr = (AstUnaryExpr *)node->as;
+    unary_expr = &ast_node(ast, node)->as.unary_expr;
 
     switch (unary_expr->op_type)
     {
     case TOK_NOT:
         reg = alloc_register(_asm);
 
-        tmp = eval_asm(unary_expr->postfix_expr, _asm);
+        tmp = eval_asm(ast, unary_expr->postfix_expr, _asm);
         emit_set_eq_zero(reg, tmp, _asm);
 
         free_register(tmp);
@@ -820,9 +811,9 @@ Register *eval_unary_expr(AstNode *node, RISCV *_asm)
     }
 }
 
-void gen_while(AstNode *node, RISCV *_asm)
+void gen_while(AstPool *ast, AstRef node, RISCV *_asm)
 {
-    AstWhile *w_stmt = (AstWhile *)node->as;
+    AstWhile *w_stmt = &ast_node(ast, node)->as.w_stmt;
     Register *reg;
     Label label = create_base_cond_label(LBL_WHILE, _asm);
     Label start_label = extend_label(label, "start");
@@ -831,13 +822,13 @@ void gen_while(AstNode *node, RISCV *_asm)
     // Add label
     emit_label(start_label, _asm);
 
-    reg = eval_asm(w_stmt->expr, _asm);
+    reg = eval_asm(ast, w_stmt->expr, _asm);
     // cmp and branch to end label
     emit_branch_eq(reg, _asm->zero, end_label, _asm);
 
     free_register(reg);
 
-    _gen_asm(w_stmt->body, _asm);
+    _gen_asm(ast, w_stmt->body, _asm);
 
     // Jump back to start
     emit_jump_label(start_label, _asm);
@@ -846,9 +837,11 @@ void gen_while(AstNode *node, RISCV *_asm)
     emit_label(end_label, _asm);
 }
 
-void gen_for(AstNode *node, RISCV *_asm)
+void gen_for(AstPool *ast, AstRef node, RISCV *_asm)
 {
-    AstFor *f_stmt = (AstFor *)node->as;
+    AstFor *f_stmt = &ast_node(ast, node)->as.f_stmt;
+    AstNodeType init = ast_node(ast, f_stmt->init)->type;
+    AstRef step = ast_for_step(ast, f_stmt);
     Register *reg = NULL;
     Label label = create_base_cond_label(LBL_FOR, _asm);
 
@@ -860,21 +853,21 @@ void gen_for(AstNode *node, RISCV *_asm)
 
     emit_label(init_label, _asm);
     // Could be expression or declartion so we need to free register
-    if (f_stmt->init->type == AST_VAR_DEC || f_stmt->init->type == AST_VAR_DEF || f_stmt->init->type == AST_EMPTY_EXPR)
+    if (init == AST_VAR_DEC || init == AST_VAR_DEF || init == AST_EMPTY_EXPR)
     {
-        _gen_asm(f_stmt->init, _asm);
+        _gen_asm(ast, f_stmt->init, _asm);
     }
     else
     {
-        reg = eval_asm(f_stmt->init, _asm);
+        reg = eval_asm(ast, f_stmt->init, _asm);
         free_register(reg);
     }
 
     emit_label(cond_label, _asm);
 
-    if (f_stmt->cond->type != AST_EMPTY_EXPR)
+    if (ast_node(ast, f_stmt->cond)->type != AST_EMPTY_EXPR)
     {
-        reg = eval_asm(f_stmt->cond, _asm);
+        reg = eval_asm(ast, f_stmt->cond, _asm);
         // cmp and branch to end label
         emit_branch_eq(reg, _asm->zero, end_label, _asm);
         free_register(reg);
@@ -882,13 +875,13 @@ void gen_for(AstNode *node, RISCV *_asm)
 
     emit_label(body_label, _asm);
 
-    _gen_asm(f_stmt->body, _asm);
+    _gen_asm(ast, ast_for_body(ast, f_stmt), _asm);
 
     emit_label(step_label, _asm);
 
-    if (f_stmt->step->type != AST_EMPTY_EXPR)
+    if (ast_node(ast, step)->type != AST_EMPTY_EXPR)
     {
-        reg = eval_asm(f_stmt->step, _asm);
+        reg = eval_asm(ast, step, _asm);
         free_register(reg);
     }
 
@@ -896,20 +889,17 @@ void gen_for(AstNode *node, RISCV *_asm)
     emit_label(end_label, _asm);
 }
 
-Register *eval_lval(AstNode *node, RISCV *_asm)
+Register *eval_lval(AstPool *ast, AstRef node, RISCV *_asm)
 {
     Register *reg;
-    AstIdent *ident_node;
     size_t offset;
-    AstLValue *lval = (AstLValue *)node->as;
-    size_t base_offset = (REGISTER_SIZE * (3 + _asm->arg->length));
+    AstLValue *lval = &ast_node(ast, node)->as.lval;
+    size_t base_offset = (REGISTER_SIZE * (3 + _asm->arg.count));
     switch (lval->kind)
     {
     case AST_LVAL_IDENT:
-        ident_node = (AstIdent *)(lval->u.ident->as);
-
         reg = alloc_register(_asm);
-        offset = ident_node->symbol->offset;
+        offset = ast_symbol(ast, lval->ident)->offset;
 
         emit_load_register(reg, base_offset + offset, _asm);
         return reg;
@@ -919,66 +909,66 @@ Register *eval_lval(AstNode *node, RISCV *_asm)
     }
 }
 
-Register *eval_asm(AstNode *node, RISCV *_asm)
+Register *eval_asm(AstPool *ast, AstRef node, RISCV *_asm)
 {
 
-    switch (node->type)
+    switch (ast_node(ast, node)->type)
     {
     case AST_UNARY_EXPR:
-        return eval_unary_expr(node, _asm);
+        return eval_unary_expr(ast, node, _asm);
     case AST_INT_CONST:
-        return eval_int_const(node, _asm);
+        return eval_int_const(ast, node, _asm);
     case AST_FUNC_CALL:
-        return eval_func_call(node, _asm);
+        return eval_func_call(ast, node, _asm);
     case AST_IDENT:
-        return eval_ident(node, _asm);
+        return eval_ident(ast, node, _asm);
     case AST_BIN_EXP:
-        return eval_bin_exp(node, _asm);
+        return eval_bin_exp(ast, node, _asm);
     case AST_VAR_ASGN:
-        return eval_var_asgn(node, _asm);
+        return eval_var_asgn(ast, node, _asm);
     case AST_LVAL:
-        return eval_lval(node, _asm);
+        return eval_lval(ast, node, _asm);
     default:
-        fprintf(stderr, "Eval Asm: Unknown AST Type (%d)\n", node->type);
+        fprintf(stderr, "Eval Asm: Unknown AST Type (%d)\n", ast_node(ast, node)->type);
         exit(1);
     }
 }
 
 // Recursively write AST representation to Assembly file
-void _gen_asm(AstNode *node, RISCV *_asm)
+void _gen_asm(AstPool *ast, AstRef node, RISCV *_asm)
 {
     Register *reg;
     AstExprStmt *expr_stmt;
 
-    switch (node->type)
+    switch (ast_node(ast, node)->type)
     {
     case AST_RET:
-        gen_ret(node, _asm);
+        gen_ret(ast, node, _asm);
         break;
     case AST_IF:
-        gen_if(node, _asm);
+        gen_if(ast, node, _asm);
         break;
     case AST_COMP_STMT:
-        gen_comp_stmt(node, _asm);
+        gen_comp_stmt(ast, node, _asm);
         break;
     case AST_FUNC_DEF:
-        gen_func_def(node, _asm);
+        gen_func_def(ast, node, _asm);
         break;
     case AST_VAR_DEF:
-        gen_var_def(node, _asm);
+        gen_var_def(ast, node, _asm);
         break;
     case AST_WHILE:
-        gen_while(node, _asm);
+        gen_while(ast, node, _asm);
         break;
     case AST_FOR:
-        gen_for(node, _asm);
+        gen_for(ast, node, _asm);
         break;
     case AST_EXPR_STMT:
-        expr_stmt = (AstExprStmt *)node->as;
-        if (expr_stmt->expr->type != AST_EMPTY_EXPR)
+        expr_stmt = &ast_node(ast, node)->as.expr_stmt;
+        if (ast_node(ast, expr_stmt->expr)->type != AST_EMPTY_EXPR)
         {
 
-            reg = eval_asm(expr_stmt->expr, _asm);
+            reg = eval_asm(ast, expr_stmt->expr, _asm);
             free_register(reg);
         }
         break;
@@ -987,7 +977,7 @@ void _gen_asm(AstNode *node, RISCV *_asm)
     case AST_VAR_DEC:
         break;
     default:
-        fprintf(stderr, "Gen Asm: Unknown AST Type (%d)\n", node->type);
+        fprintf(stderr, "Gen Asm: Unknown AST Type (%d)\n", ast_node(ast, node)->type);
         exit(1);
     }
 }
@@ -1002,10 +992,15 @@ void emit_linux_prologue(RISCV *_asm)
     ecall(_asm);
 }
 
-void asm_init(RISCV *_asm)
+void asm_init(RISCV *_asm, const char *out_name)
 {
     // Create and set up out file
-    FILE *out = fopen("./asm.s", "w");
+    FILE *out = fopen(out_name, "w");
+    if (out == NULL)
+    {
+        fprintf(stderr, "my-lang: cannot write '%s'\n", out_name);
+        exit(1);
+    }
     _asm->out = out;
     emit_linux_prologue(_asm);
 }
@@ -1015,14 +1010,14 @@ void ecall(RISCV *_asm)
     fprintf(_asm->out, "\tecall\n");
 }
 
-// Generate Assembly file from AST
-void gen_asm(Vector *prog)
+// Generate Assembly file out_name from AST
+void gen_asm(AstPool *ast, const char *out_name)
 {
     RISCV *_asm = make_riscv();
-    asm_init(_asm);
-    for (size_t i = 0; i < prog->length; i++)
+    asm_init(_asm, out_name);
+    for (size_t i = 0; i < ast_list_count(ast, ast->funcs); i++)
     {
-        _gen_asm((AstNode *)vector_get(prog, i), _asm);
+        _gen_asm(ast, ast_list_get(ast, ast->funcs, i), _asm);
     }
     fclose(_asm->out);
 }
@@ -3,6 +3,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 void printlvl(char *str, int level, ...)
 {
@@ -14,9 +15,9 @@ void printlvl(char *str, int level, ...)
     printf("\n");
 }
 
-void _print_ast(AstNode *node, int level)
+void _print_ast(AstPool *ast, AstRef ref, int level)
 {
-
+    AstNode *node = ast_node(ast, ref);
     AstCompStmt *comp_stmt;
     AstVarDef *var_def;
     AstBinExp *bin_exp;
@@ -34,200 +35,204 @@ void _print_ast(AstNode *node, int level)
     AstExprStmt *expr_stmt;
     AstUnaryExpr *unary_expr;
     AstLValue *lval;
+    AstList list;
 
     switch (node->type)
     {
     case AST_FUNC_DEF:
-        func_def = (AstFuncDef *)node->as;
+        func_def = &node->as.func_def;
+        list = ast_func_params(ast, func_def);
         printlvl("FuncDef(", level);
 
-        printlvl("\tname='%s'", level, func_def->value);
-        printlvl("\tframe_size='%d'", level, func_def->symbol->frame->size);
-        printlvl("\tparams=[", level, func_def->params);
-        for (size_t i = 0; i < func_def->params->length; i++)
+        printlvl("\tname='%s'", level, ast_name(ast, func_def->name));
+        printlvl("\tframe_size='%d'", level, ast_symbol(ast, ref)->frame->size);
+        printlvl("\tparams=[", level);
+        for (size_t i = 0; i < ast_list_count(ast, list); i++)
         {
-            printlvl("\t\t'%s'", level, ((Param *)vector_get(func_def->params, i))->value);
+            AstParam *param = &ast_node(ast, ast_list_get(ast, list, i))->as.param;
+            printlvl("\t\t'%s'", level, ast_name(ast, param->name));
         }
         printlvl("\t\t]", level);
 
         printlvl("\tbody=[", level);
-        _print_ast(func_def->body, level + 1);
+        _print_ast(ast, ast_func_body(ast, func_def), level + 1);
 
         printlvl("\t\t]", level);
         printlvl(")", level);
         break;
     case AST_VAR_DEF:
-        var_def = (AstVarDef *)node->as;
+        var_def = &node->as.var_def;
+
         printlvl("VarDef(", level);
 
-        printlvl("\tname='%s'", level, var_def->value);
-        printlvl("\tstack_offset='%d'", level, var_def->symbol->offset);
+        printlvl("\tname='%s'", level, ast_name(ast, var_def->name));
+        printlvl("\tstack_offset='%d'", level, ast_symbol(ast, ref)->offset);
         printlvl("\tvalue=(", level);
-        _print_ast(var_def->expr, level + 1);
+        _print_ast(ast, var_def->expr, level + 1);
         printlvl(")", level);
         break;
     case AST_BIN_EXP:
-        bin_exp = (AstBinExp *)node->as;
+        bin_exp = &node->as.bin_exp;
         printlvl("BinExp(", level);
-        printlvl("\top=%s", level, bin_exp->value);
+        printlvl("\top=%s", level, token_spelling(bin_exp->op_type));
 
         printlvl("\tleft=(", level);
-        _print_ast(bin_exp->left, level + 1);
+        _print_ast(ast, bin_exp->left, level + 1);
         printlvl("\t)", level);
 
         printlvl("\tright=(", level);
-        _print_ast(bin_exp->right, level + 1);
+        _print_ast(ast, bin_exp->right, level + 1);
         printlvl("\t)", level);
 
         printlvl(")", level);
         break;
 
     case AST_INT_CONST:
-        cons = (AstIntConst *)node->as;
+        cons = &node->as.int_const;
         printlvl("IntConst(%d)", level, cons->value);
         break;
     case AST_COMP_STMT:
-        comp_stmt = (AstCompStmt *)node->as;
+        comp_stmt = &node->as.comp_stmt;
 
         printlvl("Comp Stmt(", level);
-        for (size_t i = 0; i < comp_stmt->body->length; i++)
-            _print_ast((AstNode *)vector_get(comp_stmt->body, i), level + 1);
+        for (size_t i = 0; i < ast_list_count(ast, comp_stmt->body); i++)
+            _print_ast(ast, ast_list_get(ast, comp_stmt->body, i), level + 1);
         printlvl(")", level);
         break;
     case AST_IDENT:
-        ident = (AstIdent *)node->as;
+        ident = &node->as.ident;
         printlvl("Ident(", level);
-        printlvl("\tname='%s'", level, ident->value);
+        printlvl("\tname='%s'", level, ast_name(ast, ident->name));
         printlvl(")", level);
         break;
     case AST_RET:
-        ret = (AstRet *)node->as;
+        ret = &node->as.ret;
         printlvl("Return(", level);
-        _print_ast(ret->expr, level + 1);
+        _print_ast(ast, ret->expr, level + 1);
         printlvl(")", level);
         break;
     case AST_FUNC_CALL:
-        func_call = (AstFuncCall *)node->as;
+        func_call = &node->as.func_call;
         printlvl("Func Call(", level);
-        printlvl("\tname=%s", level, func_call->value);
+        printlvl("\tname=%s", level, ast_name(ast, func_call->name));
         printlvl("\targs=(", level);
-        for (size_t i = 0; i < func_call->args->length; i++)
-            _print_ast(vector_get(func_call->args, i), level + 1);
+        for (size_t i = 0; i < ast_list_count(ast, func_call->args); i++)
+            _print_ast(ast, ast_list_get(ast, func_call->args, i), level + 1);
         printlvl("\t)", level);
         break;
     case AST_ENUM:
-        enm = (AstEnum *)node->as;
+        enm = &node->as.enm;
         printlvl("Enum(", level);
-        printlvl("\tname=%s", level, enm->value);
+        printlvl("\tname=%s", level, ast_name(ast, enm->name));
         printlvl("\tenums=[", level);
-        for (size_t i = 0; i < enm->enums->length; i++)
-            printlvl("\t\t%s(%d),", level, ((char *)vector_get(enm->enums, i)), i);
+        for (size_t i = 0; i < ast_list_count(ast, enm->enums); i++)
+            printlvl("\t\t%s(%d),", level, ast_name(ast, ast_list_get(ast, enm->enums, i)), (int)i);
         printlvl("\t]", level);
         printlvl(")", level);
         break;
     case AST_IF:
-        if_stmt = (AstIfElse *)node->as;
+        if_stmt = &node->as.if_else;
         printlvl("If(", level);
 
         printlvl("\tif_expr=[", level);
-        _print_ast(if_stmt->if_expr, level);
+        _print_ast(ast, if_stmt->if_expr, level);
         printlvl("\t]", level);
 
         printlvl("\tif_body=[", level);
-        _print_ast(if_stmt->if_body, level);
+        _print_ast(ast, if_stmt->if_body, level);
         printlvl("\t]", level);
 
-        if (if_stmt->else_body != NULL)
+        if (if_stmt->else_body != AST_NONE)
         {
             printlvl("\telse_body=[", level);
-            _print_ast(if_stmt->else_body, level);
+            _print_ast(ast, if_stmt->else_body, level);
             printlvl("\t]", level);
         }
 
         break;
     case AST_VAR_DEC:
-        dec = (AstVarDec *)node->as;
+        dec = &node->as.var_dec;
 
         printlvl("VarDec(", level);
-        printlvl("\tvalue='%s'", level, dec->value);
-        printlvl("\tstack_offset='%d'", level, dec->symbol->offset);
-        printlvl("\ttype='%s'", level, dec->type);
+        printlvl("\tvalue='%s'", level, ast_name(ast, dec->name));
+        printlvl("\tstack_offset='%d'", level, ast_symbol(ast, ref)->offset);
+        printlvl("\ttype='%s'", level, ast_name(ast, dec->type));
         printlvl(")", level);
         break;
 
     case AST_VAR_ASGN:
-        asgn = (AstVarAsgn *)node->as;
+        asgn = &node->as.var_asgn;
 
         printlvl("VarAsgn(", level);
 
         printlvl("\tlval=[", level);
-        _print_ast(asgn->lval, level + 1);
+        _print_ast(ast, asgn->lval, level + 1);
         printlvl("\t]", level);
 
         printlvl("\trval=[", level);
-        _print_ast(asgn->rval, level + 1);
+        _print_ast(ast, asgn->rval, level + 1);
         printlvl("\t]", level);
 
         printlvl(")", level);
 
         break;
     case AST_WHILE:
-        w_stmt = (AstWhile *)node->as;
+        w_stmt = &node->as.w_stmt;
         printlvl("While(", level);
 
         printlvl("\texpr=[", level);
-        _print_ast(w_stmt->expr, level + 1);
+        _print_ast(ast, w_stmt->expr, level + 1);
         printlvl("\t]", level);
 
         printlvl("\tbody=[", level);
-        _print_ast(w_stmt->body, level + 1);
+        _print_ast(ast, w_stmt->body, level + 1);
         printlvl("\t]", level);
 
         printlvl(")", level);
         break;
     case AST_FOR:
-        f_stmt = (AstFor *)node->as;
+        f_stmt = &node->as.f_stmt;
         printlvl("For(", level);
 
         printlvl("\tinit=[", level);
-        _print_ast(f_stmt->init, level + 1);
+        _print_ast(ast, f_stmt->init, level + 1);
         printlvl("\t]", level);
 
         printlvl("\tcond=[", level);
-        _print_ast(f_stmt->cond, level + 1);
+        _print_ast(ast, f_stmt->cond, level + 1);
         printlvl("\t]", level);
 
         printlvl("\tstep=[", level);
-        _print_ast(f_stmt->step, level + 1);
+        _print_ast(ast, ast_for_step(ast, f_stmt), level + 1);
         printlvl("\t]", level);
 
         printlvl("\tbody=[", level);
-        _print_ast(f_stmt->body, level + 1);
+        _print_ast(ast, ast_for_body(ast, f_stmt), level + 1);
         printlvl("\t]", level);
         break;
     case AST_EXPR_STMT:
-        expr_stmt = node->as;
+        expr_stmt = &node->as.expr_stmt;
         printlvl("Expr Stmt(", level);
-        _print_ast(expr_stmt->expr, level);
+        _print_ast(ast, expr_stmt->expr, level);
         printlvl(")", level);
         break;
 
     case AST_UNARY_EXPR:
-        unary_expr = node->as;
+        unary_expr = &node->as.unary_expr;
         printlvl("Unary Expr( ", level);
-        printlvl("\top=%s", level, unary_expr->value);
+        printlvl("\top=%s", level, token_spelling(unary_expr->op_type));
         printlvl("\texpr=[", level);
-        _print_ast(unary_expr->postfix_expr, level + 1);
+        _print_ast(ast, unary_expr->postfix_expr, level + 1);
         printlvl("\t]", level);
         printlvl(")", level);
         break;
 
     case AST_LVAL:
-        lval = (AstLValue *)node->as;
+        lval = &node->as.lval;
         switch (lval->kind)
         {
         case AST_LVAL_IDENT:
-            _print_ast(lval->u.ident, level);
+            _print_ast(ast, lval->ident, level);
             break;
         default:
             fprintf(stderr, "Print Ast: Unknown AST LValue Type (%d)\n", lval->kind);
@@ -243,158 +248,569 @@ void _print_ast(AstNode *node, int level)
     }
 }
 
-void dump_ast(Vector *prog)
+void dump_ast(AstPool *ast)
+{
+    for (size_t i = 0; i < ast_list_count(ast, ast->funcs); i++)
+    {
+
+        _print_ast(ast, ast_list_get(ast, ast->funcs, i), 0);
+    }
+}
+
+AstPool *ast_pool_new(Arena *arena)
+{
+    AstPool *ast = arena_alloc(arena, sizeof(AstPool));
+    memset(ast, 0, sizeof(AstPool));
+    ast->arena = arena;
+
+    // Takes up AST_NONE
+    AstNode none = {.type = AST_EMPTY_EXPR};
+    arena_da_append(arena, &ast->nodes, none);
+    // An empty list, so a pool that never parsed anything has no functions
+    arena_da_append(arena, &ast->extra, 0);
+    return ast;
+}
+
+#define AST_RESERVE(ast, da, n)                                                                                        \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if ((da)->capacity < (n))                                                                                      \
+        {                                                                                                              \
+            (da)->items = arena_realloc((ast)->arena, (da)->items, (da)->capacity * sizeof(*(da)->items),              \
+                                        (n) * sizeof(*(da)->items));                                                   \
+            (da)->capacity = (n);                                                                                      \
+        }                                                                                                              \
+    } while (0)
+
+// Size the arrays for a program of about 'tokens' tokens up front. Growing
+// them by doubling leaves every outgrown copy behind in the arena.
+void ast_pool_reserve(AstPool *ast, size_t tokens)
+{
+    ast_pool_reserve_items(ast, tokens * 3 / 4 + 1, tokens / 3 + 1, tokens / 4 + 1);
+}
+
+void ast_pool_reserve_items(AstPool *ast, size_t nodes, size_t names, size_t extra)
+{
+    AST_RESERVE(ast, &ast->nodes, nodes);
+    AST_RESERVE(ast, &ast->names, names);
+    AST_RESERVE(ast, &ast->extra, extra);
+}
+
+#undef AST_RESERVE
+
+AstRef ast_rebase_ref(AstRef ref, AstOffsets at)
+{
+    return ref != AST_NONE ? ref - 1 + at.nodes : AST_NONE;
+}
+
+static AstName rebase_name(AstName name, AstOffsets at)
+{
+    return name + at.names;
+}
+
+// Lists and extra children never start at the empty list in slot 0
+static uint32_t rebase_extra(uint32_t index, AstOffsets at)
+{
+    return index != 0 ? index - 1 + at.extra : 0;
+}
+
+static void rebase_refs(AstPool *ast, AstList list, AstOffsets at)
+{
+    uint32_t *items = ast->extra.items + list + 1;
+    for (size_t i = 0; i < ast->extra.items[list]; i++)
+        items[i] = ast_rebase_ref(items[i], at);
+}
+
+static void rebase_names(AstPool *ast, AstList list, AstOffsets at)
+{
+    uint32_t *items = ast->extra.items + list + 1;
+    for (size_t i = 0; i < ast->extra.items[list]; i++)
+        items[i] = rebase_name(items[i], at);
+}
+
+// Rebase the indices held by a node that was copied into ast, together
+// with the lists it owns. Every list has exactly one owner.
+static void rebase_node(AstPool *ast, AstNode *node, AstOffsets at)
+{
+    uint32_t *extra;
+
+    switch (node->type)
+    {
+    case AST_LVAL:
+        node->as.lval.ident = ast_rebase_ref(node->as.lval.ident, at);
+        break;
+    case AST_COMP_STMT:
+        node->as.comp_stmt.body = rebase_extra(node->as.comp_stmt.body, at);
+        rebase_refs(ast, node->as.comp_stmt.body, at);
+        break;
+    case AST_BIN_EXP:
+        node->as.bin_exp.left = ast_rebase_ref(node->as.bin_exp.left, at);
+        node->as.bin_exp.right = ast_rebase_ref(node->as.bin_exp.right, at);
+        break;
+    case AST_FUNC_DEF:
+        node->as.func_def.name = rebase_name(node->as.func_def.name, at);
+        node->as.func_def.type = rebase_name(node->as.func_def.type, at);
+        node->as.func_def.extra = rebase_extra(node->as.func_def.extra, at);
+        extra = ast->extra.items + node->as.func_def.extra;
+        extra[0] = rebase_extra(extra[0], at);
+        rebase_refs(ast, extra[0], at);
+        extra[1] = ast_rebase_ref(extra[1], at);
+        break;
+    case AST_PARAM:
+        node->as.param.name = rebase_name(node->as.param.name, at);
+        node->as.param.type = rebase_name(node->as.param.type, at);
+        break;
+    case AST_IDENT:
+        node->as.ident.name = rebase_name(node->as.ident.name, at);
+        break;
+    case AST_RET:
+        node->as.ret.expr = ast_rebase_ref(node->as.ret.expr, at);
+        break;
+    case AST_FUNC_CALL:
+        node->as.func_call.name = rebase_name(node->as.func_call.name, at);
+        node->as.func_call.args = rebase_extra(node->as.func_call.args, at);
+        rebase_refs(ast, node->as.func_call.args, at);
+        break;
+    case AST_VAR_DEF:
+        node->as.var_def.name = rebase_name(node->as.var_def.name, at);
+        node->as.var_def.type = rebase_name(node->as.var_def.type, at);
+        node->as.var_def.expr = ast_rebase_ref(node->as.var_def.expr, at);
+        break;
+    case AST_VAR_DEC:
+        node->as.var_dec.name = rebase_name(node->as.var_dec.name, at);
+        node->as.var_dec.type = rebase_name(node->as.var_dec.type, at);
+        break;
+    case AST_VAR_ASGN:
+        node->as.var_asgn.lval = ast_rebase_ref(node->as.var_asgn.lval, at);
+        node->as.var_asgn.rval = ast_rebase_ref(node->as.var_asgn.rval, at);
+        break;
+    case AST_IF:
+        node->as.if_else.if_expr = ast_rebase_ref(node->as.if_else.if_expr, at);
+        node->as.if_else.if_body = ast_rebase_ref(node->as.if_else.if_body, at);
+        node->as.if_else.else_body = ast_rebase_ref(node->as.if_else.else_body, at);
+        break;
+    case AST_ENUM:
+        node->as.enm.name = rebase_name(node->as.enm.name, at);
+        node->as.enm.enums = rebase_extra(node->as.enm.enums, at);
+        rebase_names(ast, node->as.enm.enums, at);
+        break;
+    case AST_WHILE:
+        node->as.w_stmt.expr = ast_rebase_ref(node->as.w_stmt.expr, at);
+        node->as.w_stmt.body = ast_rebase_ref(node->as.w_stmt.body, at);
+        break;
+    case AST_FOR:
+        node->as.f_stmt.init = ast_rebase_ref(node->as.f_stmt.init, at);
+        node->as.f_stmt.cond = ast_rebase_ref(node->as.f_stmt.cond, at);
+        node->as.f_stmt.extra = rebase_extra(node->as.f_stmt.extra, at);
+        extra = ast->extra.items + node->as.f_stmt.extra;
+        extra[0] = ast_rebase_ref(extra[0], at);
+        extra[1] = ast_rebase_ref(extra[1], at);
+        break;
+    case AST_EXPR_STMT:
+        node->as.expr_stmt.expr = ast_rebase_ref(node->as.expr_stmt.expr, at);
+        break;
+    case AST_UNARY_EXPR:
+        node->as.unary_expr.postfix_expr = ast_rebase_ref(node->as.unary_expr.postfix_expr, at);
+        break;
+    default:
+        break;
+    }
+}
+
+// Copy everything but the placeholders of 'from' into the arrays of
+// 'into', which must already hold the slots starting at 'at'. Indices
+// are rebased, a ref r of 'from' becomes ast_rebase_ref(r, at). Copies
+// into disjoint slots can run on different threads.
+void ast_pool_copy(AstPool *into, const AstPool *from, AstOffsets at)
+{
+    size_t nodes = from->nodes.count - 1;
+
+    memcpy(into->nodes.items + at.nodes, from->nodes.items + 1, nodes * sizeof(AstNode));
+    memcpy(into->names.items + at.names, from->names.items, from->names.count * sizeof(char *));
+    memcpy(into->extra.items + at.extra, from->extra.items + 1, (from->extra.count - 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < nodes; i++)
+        rebase_node(into, &into->nodes.items[at.nodes + i], at);
+}
+
+// Children come before their parents in the pool, ruling out cycles.
+// AST_NONE is accepted for every child.
+static bool ref_valid(AstRef ref, AstRef parent)
+{
+    return ref < parent;
+}
+
+static bool op_valid(TokenType op_type)
+{
+    return (unsigned)op_type < TOK_EOF;
+}
+
+static bool name_valid(const AstPool *ast, AstName name)
+{
+    return name < ast->names.count;
+}
+
+// Whether 'length' entries starting at index fit in extra
+static bool extra_valid(const AstPool *ast, uint32_t index, size_t length)
+{
+    return (size_t)index + length <= ast->extra.count;
+}
+
+static bool list_valid(const AstPool *ast, AstList list)
+{
+    return list < ast->extra.count && extra_valid(ast, list + 1, ast->extra.items[list]);
+}
+
+static bool refs_valid(const AstPool *ast, AstList list, AstRef parent)
+{
+    if (!list_valid(ast, list))
+        return false;
+    for (size_t i = 0; i < ast->extra.items[list]; i++)
+    {
+        if (!ref_valid(ast->extra.items[list + 1 + i], parent))
+            return false;
+    }
+    return true;
+}
+
+static bool names_valid(const AstPool *ast, AstList list)
 {
-    for (size_t i = 0; i < prog->length; i++)
+    if (!list_valid(ast, list))
+        return false;
+    for (size_t i = 0; i < ast->extra.items[list]; i++)
     {
+        if (!name_valid(ast, ast->extra.items[list + 1 + i]))
+            return false;
+    }
+    return true;
+}
+
+// Same cases as rebase_node(), every index a node holds is checked
+static bool node_valid(const AstPool *ast, AstRef ref)
+{
+    const AstNode *node = &ast->nodes.items[ref];
+    const uint32_t *extra;
+
+    switch (node->type)
+    {
+    case AST_INT_CONST:
+    case AST_BOOL_EXPR:
+    case AST_EMPTY_EXPR:
+        return true;
+    case AST_LVAL:
+        return ref_valid(node->as.lval.ident, ref);
+    case AST_COMP_STMT:
+        return refs_valid(ast, node->as.comp_stmt.body, ref);
+    case AST_BIN_EXP:
+        return op_valid(node->as.bin_exp.op_type) && ref_valid(node->as.bin_exp.left, ref) &&
+               ref_valid(node->as.bin_exp.right, ref);
+    case AST_FUNC_DEF:
+        if (!name_valid(ast, node->as.func_def.name) || !name_valid(ast, node->as.func_def.type) ||
+            !extra_valid(ast, node->as.func_def.extra, 2))
+            return false;
+        extra = ast->extra.items + node->as.func_def.extra;
+        return refs_valid(ast, extra[0], ref) && ref_valid(extra[1], ref);
+    case AST_PARAM:
+        return name_valid(ast, node->as.param.name) && name_valid(ast, node->as.param.type);
+    case AST_IDENT:
+        return name_valid(ast, node->as.ident.name);
+    case AST_RET:
+        return ref_valid(node->as.ret.expr, ref);
+    case AST_FUNC_CALL:
+        return name_valid(ast, node->as.func_call.name) && refs_valid(ast, node->as.func_call.args, ref);
+    case AST_VAR_DEF:
+        return name_valid(ast, node->as.var_def.name) && name_valid(ast, node->as.var_def.type) &&
+               ref_valid(node->as.var_def.expr, ref);
+    case AST_VAR_DEC:
+        return name_valid(ast, node->as.var_dec.name) && name_valid(ast, node->as.var_dec.type);
+    case AST_VAR_ASGN:
+        return ref_valid(node->as.var_asgn.lval, ref) && ref_valid(node->as.var_asgn.rval, ref);
+    case AST_IF:
+        return ref_valid(node->as.if_else.if_expr, ref) && ref_valid(node->as.if_else.if_body, ref) &&
+               ref_valid(node->as.if_else.else_body, ref);
+    case AST_ENUM:
+        return name_valid(ast, node->as.enm.name) && names_valid(ast, node->as.enm.enums);
+    case AST_WHILE:
+        return ref_valid(node->as.w_stmt.expr, ref) && ref_valid(node->as.w_stmt.body, ref);
+    case AST_FOR:
+        if (!ref_valid(node->as.f_stmt.init, ref) || !ref_valid(node->as.f_stmt.cond, ref) ||
+            !extra_valid(ast, node->as.f_stmt.extra, 2))
+            return false;
+        extra = ast->extra.items + node->as.f_stmt.extra;
+        return ref_valid(extra[0], ref) && ref_valid(extra[1], ref);
+    case AST_EXPR_STMT:
+        return ref_valid(node->as.expr_stmt.expr, ref);
+    case AST_UNARY_EXPR:
+        return op_valid(node->as.unary_expr.op_type) && ref_valid(node->as.unary_expr.postfix_expr, ref);
+    default:
+        return false;
+    }
+}
 
-        _print_ast((AstNode *)vector_get(prog, i), 0);
+// Whether every ref, name and list held by the nodes of ast, and the
+// list of functions, is in range and the node and operator types are
+// known. For
+// pools that were not built by the parser, such as cache files.
+bool ast_pool_valid(const AstPool *ast)
+{
+    if (ast->nodes.count == 0 || ast->extra.count == 0 || ast->extra.items[0] != 0)
+        return false;
+    for (AstRef ref = 1; ref < ast->nodes.count; ref++)
+    {
+        if (!node_valid(ast, ref))
+            return false;
     }
+    if (!refs_valid(ast, ast->funcs, (AstRef)ast->nodes.count))
+        return false;
+    for (size_t i = 0; i < ast->extra.items[ast->funcs]; i++)
+    {
+        if (ast->nodes.items[ast->extra.items[ast->funcs + 1 + i]].type != AST_FUNC_DEF)
+            return false;
+    }
+    return true;
+}
+
+AstNode *ast_node(const AstPool *ast, AstRef ref)
+{
+    return &ast->nodes.items[ref];
+}
+
+char *ast_name(const AstPool *ast, AstName name)
+{
+    return ast->names.items[name];
+}
+
+// NULL before sema has run or for nodes without a symbol
+SymTabEntry *ast_symbol(const AstPool *ast, AstRef ref)
+{
+    return ast->symbols ? ast->symbols[ref] : NULL;
+}
+
+size_t ast_list_count(const AstPool *ast, AstList list)
+{
+    return ast->extra.items[list];
+}
+
+uint32_t ast_list_get(const AstPool *ast, AstList list, size_t i)
+{
+    return ast->extra.items[list + 1 + i];
+}
+
+// Start a list, its items are pushed to the scratch stack until
+// ast_list_end() copies them to extra. Returns the mark to pass to it.
+size_t ast_list_begin(AstPool *ast)
+{
+    return ast->scratch.count;
+}
+
+void ast_list_push(AstPool *ast, uint32_t item)
+{
+    arena_da_append(ast->arena, &ast->scratch, item);
+}
+
+AstList ast_list_end(AstPool *ast, size_t mark)
+{
+    size_t count = ast->scratch.count - mark;
+    AstList list = (AstList)ast->extra.count;
+
+    arena_da_append(ast->arena, &ast->extra, (uint32_t)count);
+    arena_da_append_many(ast->arena, &ast->extra, ast->scratch.items + mark, count);
+    ast->scratch.count = mark;
+    return list;
+}
+
+AstName ast_add_name(AstPool *ast, char *name)
+{
+    arena_da_append(ast->arena, &ast->names, name);
+    return (AstName)(ast->names.count - 1);
+}
+
+AstList ast_func_params(const AstPool *ast, const AstFuncDef *func_def)
+{
+    return ast->extra.items[func_def->extra];
+}
+
+AstRef ast_func_body(const AstPool *ast, const AstFuncDef *func_def)
+{
+    return ast->extra.items[func_def->extra + 1];
+}
+
+AstRef ast_for_step(const AstPool *ast, const AstFor *f_stmt)
+{
+    return ast->extra.items[f_stmt->extra];
+}
+
+AstRef ast_for_body(const AstPool *ast, const AstFor *f_stmt)
+{
+    return ast->extra.items[f_stmt->extra + 1];
+}
+
+// Append a node and return its index
+static AstRef ast_add(AstPool *ast, AstNode node)
+{
+    if (ast->nodes.count > UINT32_MAX)
+    {
+        fprintf(stderr, "Too many AST nodes\n");
+        exit(1);
+    }
+    arena_da_append(ast->arena, &ast->nodes, node);
+    return (AstRef)(ast->nodes.count - 1);
+}
+
+// Store two values that do not fit into a node, returns their index in extra
+static uint32_t ast_add_extra(AstPool *ast, uint32_t first, uint32_t second)
+{
+    uint32_t index = (uint32_t)ast->extra.count;
+    arena_da_append(ast->arena, &ast->extra, first);
+    arena_da_append(ast->arena, &ast->extra, second);
+    return index;
+}
+
+AstRef make_ast_lval(AstPool *ast, AstLValueKind kind, AstRef ident)
+{
+    AstNode node = {.type = AST_LVAL};
+    node.as.lval.kind = kind;
+    node.as.lval.ident = ident;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_node(AstNodeType type, void *inner)
+AstRef make_ast_unary_expr(AstPool *ast, AstRef postfix_expr, TokenType op_type)
 {
-    AstNode *node = (AstNode *)context_alloc(sizeof(AstNode));
-    node->type = type;
-    node->as = inner;
-    return node;
+    AstNode node = {.type = AST_UNARY_EXPR};
+    node.as.unary_expr.postfix_expr = postfix_expr;
+    node.as.unary_expr.op_type = op_type;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_lval(AstLValueKind kind)
+AstRef make_expr_stmt(AstPool *ast, AstRef expr)
 {
-    AstLValue *lval = (AstLValue *)context_alloc(sizeof(AstLValue));
-    lval->kind = kind;
-    return make_ast_node(AST_LVAL, lval);
+    AstNode node = {.type = AST_EXPR_STMT};
+    node.as.expr_stmt.expr = expr;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_unary_expr(AstNode *postfix_expr, char *value, TokenType op_type)
+AstRef make_ast_enum(AstPool *ast, AstName name, AstList enums)
 {
-    AstUnaryExpr *unary_expr = (AstUnaryExpr *)context_alloc(sizeof(AstUnaryExpr));
-    unary_expr->postfix_expr = postfix_expr;
-    unary_expr->value = value;
-    unary_expr->op_type = op_type;
-    return make_ast_node(AST_UNARY_EXPR, unary_expr);
+    AstNode node = {.type = AST_ENUM};
+    node.as.enm.enums = enums;
+    node.as.enm.name = name;
+    return ast_add(ast, node);
 }
 
-AstNode *make_expr_stmt(AstNode *expr)
+AstRef make_ast_comp_stmt(AstPool *ast, AstList body)
 {
-    AstExprStmt *stmt = (AstExprStmt *)context_alloc(sizeof(AstExprStmt));
-    stmt->expr = expr;
-    return make_ast_node(AST_EXPR_STMT, stmt);
+    AstNode node = {.type = AST_COMP_STMT};
+    node.as.comp_stmt.body = body;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_enum(char *value, Vector *enums)
+AstRef make_int_const(AstPool *ast, int value)
 {
-    AstEnum *enm = (AstEnum *)context_alloc(sizeof(AstEnum));
-    enm->enums = enums;
-    enm->value = value;
-    return make_ast_node(AST_ENUM, enm);
+    AstNode node = {.type = AST_INT_CONST};
+    node.as.int_const.value = value;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_comp_stmt(Vector *body)
+AstRef make_ast_bin_exp(AstPool *ast, TokenType op_type, AstRef left, AstRef right)
 {
-    AstCompStmt *stmt = (AstCompStmt *)context_alloc(sizeof(AstCompStmt));
-    stmt->body = body;
-    return make_ast_node(AST_COMP_STMT, stmt);
+    AstNode node = {.type = AST_BIN_EXP};
+    node.as.bin_exp.left = left;
+    node.as.bin_exp.right = right;
+    node.as.bin_exp.op_type = op_type;
+    return ast_add(ast, node);
 }
 
-AstNode *make_int_const(int value)
+AstRef make_ast_func_def(AstPool *ast, AstName name, AstName type, AstRef body, AstList params)
 {
-    AstIntConst *int_const = (AstIntConst *)context_alloc(sizeof(AstIntConst));
-    int_const->value = value;
-    return make_ast_node(AST_INT_CONST, int_const);
+    AstNode node = {.type = AST_FUNC_DEF};
+    node.as.func_def.name = name;
+    node.as.func_def.type = type;
+    node.as.func_def.extra = ast_add_extra(ast, params, body);
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_bin_exp(char *value, TokenType op_type, AstNode *left, AstNode *right)
+AstRef make_ast_param(AstPool *ast, AstName name, AstName type)
 {
-    AstBinExp *bin_exp = (AstBinExp *)context_alloc(sizeof(AstBinExp));
-    bin_exp->left = left;
-    bin_exp->right = right;
-    bin_exp->value = value;
-    bin_exp->op_type = op_type;
-    return make_ast_node(AST_BIN_EXP, bin_exp);
+    AstNode node = {.type = AST_PARAM};
+    node.as.param.name = name;
+    node.as.param.type = type;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_func_def(char *value, char *type, AstNode *body, Vector *params)
+AstRef make_ast_ident(AstPool *ast, AstName name)
 {
-    AstFuncDef *func_def = (AstFuncDef *)context_alloc(sizeof(AstFuncDef));
-    func_def->body = body;
-    func_def->value = value;
-    func_def->type = type;
-    func_def->params = params;
-    return make_ast_node(AST_FUNC_DEF, func_def);
+    AstNode node = {.type = AST_IDENT};
+    node.as.ident.name = name;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_ident(char *value)
+AstRef make_ast_ret(AstPool *ast, AstRef expr)
 {
-    AstIdent *ident = (AstIdent *)context_alloc(sizeof(AstIdent));
-    ident->value = value;
-    return make_ast_node(AST_IDENT, ident);
+    AstNode node = {.type = AST_RET};
+    node.as.ret.expr = expr;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_ret(AstNode *expr)
+AstRef make_ast_func_call(AstPool *ast, AstName name, AstList args)
 {
-    AstRet *ret = (AstRet *)context_alloc(sizeof(AstRet));
-    ret->expr = expr;
-    return make_ast_node(AST_RET, ret);
+    AstNode node = {.type = AST_FUNC_CALL};
+    node.as.func_call.name = name;
+    node.as.func_call.args = args;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_func_call(char *value, Vector *args)
+AstRef make_ast_var_dec(AstPool *ast, AstName name, AstName type)
 {
-    AstFuncCall *func_call = (AstFuncCall *)context_alloc(sizeof(AstFuncCall));
-    func_call->value = value;
-    func_call->args = args;
-    return make_ast_node(AST_FUNC_CALL, func_call);
+    AstNode node = {.type = AST_VAR_DEC};
+    node.as.var_dec.name = name;
+    node.as.var_dec.type = type;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_var_dec(char *value, char *type)
+AstRef make_ast_var_asgn(AstPool *ast, AstRef lval, AstRef rval)
 {
-    AstVarDec *dec = (AstVarDec *)context_alloc(sizeof(AstVarDec));
-    dec->value = value;
-    dec->type = type;
-    return make_ast_node(AST_VAR_DEC, dec);
+    AstNode node = {.type = AST_VAR_ASGN};
+    node.as.var_asgn.rval = rval;
+    node.as.var_asgn.lval = lval;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_var_asgn(AstNode *lval, AstNode *rval)
+AstRef make_ast_var_def(AstPool *ast, AstName name, AstName type, AstRef expr)
 {
-    AstVarAsgn *asgn = (AstVarAsgn *)context_alloc(sizeof(AstVarAsgn));
-    asgn->rval = rval;
-    asgn->lval = lval;
-    return make_ast_node(AST_VAR_ASGN, asgn);
+    AstNode node = {.type = AST_VAR_DEF};
+    node.as.var_def.name = name;
+    node.as.var_def.type = type;
+    node.as.var_def.expr = expr;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_var_def(char *value, char *type, AstNode *expr)
+AstRef make_ast_if_else(AstPool *ast, AstRef if_expr, AstRef if_body, AstRef else_body)
 {
-    AstVarDef *var_def = (AstVarDef *)context_alloc(sizeof(AstVarDef));
-    var_def->value = value;
-    var_def->type = type;
-    var_def->expr = expr;
-    return make_ast_node(AST_VAR_DEF, var_def);
+    AstNode node = {.type = AST_IF};
+    node.as.if_else.if_body = if_body;
+    node.as.if_else.if_expr = if_expr;
+    node.as.if_else.else_body = else_body;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_if_else(AstNode *if_expr, AstNode *if_body, AstNode *else_body)
+AstRef make_ast_while(AstPool *ast, AstRef expr, AstRef body)
 {
-    AstIfElse *if_stmt = (AstIfElse *)context_alloc(sizeof(AstIfElse));
-    if_stmt->if_body = if_body;
-    if_stmt->if_expr = if_expr;
-    if_stmt->else_body = else_body;
-    return make_ast_node(AST_IF, if_stmt);
+    AstNode node = {.type = AST_WHILE};
+    node.as.w_stmt.body = body;
+    node.as.w_stmt.expr = expr;
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_while(AstNode *expr, AstNode *body)
+AstRef make_ast_for(AstPool *ast, AstRef init, AstRef cond, AstRef step, AstRef body)
 {
-    AstWhile *w_stmt = (AstWhile *)context_alloc(sizeof(AstWhile));
-    w_stmt->body = body;
-    w_stmt->expr = expr;
-    return make_ast_node(AST_WHILE, w_stmt);
+    AstNode node = {.type = AST_FOR};
+    node.as.f_stmt.init = init;
+    node.as.f_stmt.cond = cond;
+    node.as.f_stmt.extra = ast_add_extra(ast, step, body);
+    return ast_add(ast, node);
 }
 
-AstNode *make_ast_for(AstNode *init, AstNode *cond, AstNode *step, AstNode *body)
+AstRef make_ast_empty_expr(AstPool *ast)
 {
-    AstFor *f_stmt = (AstFor *)context_alloc(sizeof(AstFor));
-    f_stmt->init = init;
-    f_stmt->cond = cond;
-    f_stmt->step = step;
-    f_stmt->body = body;
-    return make_ast_node(AST_FOR, f_stmt);
+    AstNode node = {.type = AST_EMPTY_EXPR};
+    return ast_add(ast, node);
 }
@@ -0,0 +1,570 @@
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <inttypes.h>
+#include <mylang/ast_cache.h>
+#include <mylang/hashmap.h>
+#include <mylang/intern.h>
+#include <mylang/util.h>
+#include <mylang/version.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define AST_CACHE_MAGIC "MYLANGAC"
+// Reads back as a different value on a host of the other byte order
+#define AST_CACHE_BYTE_ORDER 0x01020304u
+#define PTR_MAP_INIT_SIZE 256
+
+// Sections follow the header in this order, each padded to 8 bytes.
+// Indices into the symbol, frame and string tables are stored plus one,
+// so that 0 can stand for NULL.
+typedef enum AstCacheSection
+{
+    // AstNode per node
+    SEC_NODES,
+    // AstPool.extra
+    SEC_EXTRA,
+    // String of each AstPool.names entry
+    SEC_NAMES,
+    // Symbol of each node
+    SEC_NODE_SYMBOLS,
+    // AstCacheSymbol table
+    SEC_SYMBOLS,
+    // AstCacheFrame table
+    SEC_FRAMES,
+    // Symbols sema_check() returned, checked for unused variables
+    SEC_CHECKED,
+    // Start of every string in SEC_TEXT, plus the end of the last one
+    SEC_STRINGS,
+    // NUL-terminated strings
+    SEC_TEXT,
+    AST_CACHE_SECTIONS
+} AstCacheSection;
+
+typedef struct AstCacheSymbol
+{
+    uint64_t offset;
+    uint32_t key;
+    uint32_t frame;
+    uint32_t param_count;
+    int32_t const_value;
+    int32_t arg_reg;
+    uint8_t symbol;
+    uint8_t type;
+    uint8_t is_arg_loaded;
+    uint8_t is_used;
+} AstCacheSymbol;
+
+typedef struct AstCacheFrame
+{
+    uint64_t size;
+    uint32_t func;
+    uint32_t unused;
+} AstCacheFrame;
+
+typedef struct AstCacheHeader
+{
+    char magic[8];
+    uint32_t format;
+    uint32_t byte_order;
+    char version[32];
+    uint64_t source_hash;
+    uint64_t source_length;
+    // hash_bytes() of everything behind the header
+    uint64_t checksum;
+    AstList funcs;
+    uint32_t counts[AST_CACHE_SECTIONS];
+} AstCacheHeader;
+
+static const size_t section_item_size[AST_CACHE_SECTIONS] = {
+    sizeof(AstNode),        sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(AstCacheSymbol),
+    sizeof(AstCacheFrame), sizeof(uint32_t), sizeof(uint32_t), sizeof(char),
+};
+
+// Maps the pointers written so far to their index in a table
+typedef struct PtrMap
+{
+    const void **keys;
+    uint32_t *values;
+    size_t size;
+    size_t count;
+} PtrMap;
+
+typedef struct CacheWriter
+{
+    Arena *arena;
+    PtrMap strings;
+    PtrMap symbols;
+    PtrMap frames;
+    struct
+    {
+        uint32_t *items;
+        size_t count;
+        size_t capacity;
+    } offsets;
+    struct
+    {
+        char *items;
+        size_t count;
+        size_t capacity;
+    } text;
+    struct
+    {
+        AstCacheSymbol *items;
+        size_t count;
+        size_t capacity;
+    } symbol_table;
+    struct
+    {
+        AstCacheFrame *items;
+        size_t count;
+        size_t capacity;
+    } frame_table;
+} CacheWriter;
+
+static size_t ptr_slot(const PtrMap *map, const void *key)
+{
+    uint64_t h = (uint64_t)(uintptr_t)key * 0x9E3779B97F4A7C15ull;
+    size_t i = (size_t)(h >> 32) & (map->size - 1);
+    while (map->keys[i] != NULL && map->keys[i] != key)
+        i = (i + 1) & (map->size - 1);
+    return i;
+}
+
+static void ptr_map_put(Arena *arena, PtrMap *map, const void *key, uint32_t value)
+{
+    // Keep the load factor under 1/2
+    if ((map->count + 1) * 2 > map->size)
+    {
+        PtrMap grown = {0};
+        grown.size = map->size ? map->size * 2 : PTR_MAP_INIT_SIZE;
+        grown.keys = arena_alloc(arena, grown.size * sizeof(void *));
+        grown.values = arena_alloc(arena, grown.size * sizeof(uint32_t));
+        memset(grown.keys, 0, grown.size * sizeof(void *));
+        for (size_t i = 0; i < map->size; i++)
+        {
+            if (map->keys[i] != NULL)
+                ptr_map_put(arena, &grown, map->keys[i], map->values[i]);
+        }
+        *map = grown;
+    }
+
+    size_t i = ptr_slot(map, key);
+    map->count += map->keys[i] == NULL;
+    map->keys[i] = key;
+    map->values[i] = value;
+}
+
+// 0 if key has not been added
+static uint32_t ptr_map_get(const PtrMap *map, const void *key)
+{
+    if (map->size == 0)
+        return 0;
+    size_t i = ptr_slot(map, key);
+    return map->keys[i] != NULL ? map->values[i] : 0;
+}
+
+// Strings are deduplicated by pointer, which covers every interned name
+static uint32_t write_string(CacheWriter *w, const char *str)
+{
+    if (str == NULL)
+        return 0;
+    uint32_t index = ptr_map_get(&w->strings, str);
+    if (index)
+        return index;
+
+    arena_da_append(w->arena, &w->offsets, (uint32_t)w->text.count);
+    arena_da_append_many(w->arena, &w->text, str, strlen(str) + 1);
+    index = (uint32_t)w->offsets.count;
+    ptr_map_put(w->arena, &w->strings, str, index);
+    return index;
+}
+
+static uint32_t write_frame(CacheWriter *w, const StackFrame *frame)
+{
+    if (frame == NULL)
+        return 0;
+    uint32_t index = ptr_map_get(&w->frames, frame);
+    if (index)
+        return index;
+
+    AstCacheFrame out = {0};
+    out.size = frame->size;
+    out.func = write_string(w, frame->func);
+    arena_da_append(w->arena, &w->frame_table, out);
+    index = (uint32_t)w->frame_table.count;
+    ptr_map_put(w->arena, &w->frames, frame, index);
+    return index;
+}
+
+static uint32_t write_symbol(CacheWriter *w, const SymTabEntry *entry)
+{
+    if (entry == NULL)
+        return 0;
+    uint32_t index = ptr_map_get(&w->symbols, entry);
+    if (index)
+        return index;
+
+    AstCacheSymbol out = {0};
+    out.offset = entry->offset;
+    out.key = write_string(w, entry->key);
+    out.frame = write_frame(w, entry->frame);
+    out.param_count = (uint32_t)entry->param_count;
+    out.const_value = entry->const_value;
+    out.arg_reg = entry->arg_reg;
+    out.symbol = (uint8_t)entry->symbol;
+    out.type = (uint8_t)entry->type;
+    out.is_arg_loaded = entry->is_arg_loaded;
+    out.is_used = entry->is_used;
+    arena_da_append(w->arena, &w->symbol_table, out);
+    index = (uint32_t)w->symbol_table.count;
+    ptr_map_put(w->arena, &w->symbols, entry, index);
+    return index;
+}
+
+static size_t section_size(const uint32_t *counts, int section)
+{
+    size_t size = counts[section] * section_item_size[section];
+    return (size + 7) & ~(size_t)7;
+}
+
+static size_t body_size(const uint32_t *counts)
+{
+    size_t size = 0;
+    for (int s = 0; s < AST_CACHE_SECTIONS; s++)
+        size += section_size(counts, s);
+    return size;
+}
+
+static void header_init(AstCacheHeader *header, uint64_t source_hash, size_t source_length)
+{
+    memset(header, 0, sizeof(AstCacheHeader));
+    memcpy(header->magic, AST_CACHE_MAGIC, sizeof(header->magic));
+    header->format = AST_CACHE_FORMAT;
+    header->byte_order = AST_CACHE_BYTE_ORDER;
+    strncpy(header->version, MYLANG_VERSION, sizeof(header->version) - 1);
+    header->source_hash = source_hash;
+    header->source_length = source_length;
+}
+
+// Cache file of a source in dir, named after the hash of the source
+char *ast_cache_path(const char *dir, uint64_t source_hash)
+{
+    return arena_sprintf(context_arena, "%s/%016" PRIx64 ".ast", dir, source_hash);
+}
+
+// Write the AST and the symbols sema_check() resolved for it. The file is
+// written under a unique temporary name and renamed, so concurrent
+// compiles, in this process or others, never see half of it or write
+// the same temporary file. Returns false if it could not be written.
+bool ast_cache_write(const char *path, AstPool *ast, SymbolVec *symbols, uint64_t source_hash, size_t source_length)
+{
+    Arena arena = {0};
+    CacheWriter w = {0};
+    AstCacheHeader header;
+    w.arena = &arena;
+
+    uint32_t *names = arena_alloc(&arena, ast->names.count * sizeof(uint32_t));
+    for (size_t i = 0; i < ast->names.count; i++)
+        names[i] = write_string(&w, ast->names.items[i]);
+
+    uint32_t *node_symbols = arena_alloc(&arena, ast->nodes.count * sizeof(uint32_t));
+    for (size_t i = 0; i < ast->nodes.count; i++)
+        node_symbols[i] = write_symbol(&w, ast_symbol(ast, (AstRef)i));
+
+    uint32_t *checked = arena_alloc(&arena, symbols->count * sizeof(uint32_t));
+    for (size_t i = 0; i < symbols->count; i++)
+        checked[i] = write_symbol(&w, symbols->items[i]);
+    arena_da_append(&arena, &w.offsets, (uint32_t)w.text.count);
+
+    header_init(&header, source_hash, source_length);
+    header.funcs = ast->funcs;
+    header.counts[SEC_NODES] = (uint32_t)ast->nodes.count;
+    header.counts[SEC_EXTRA] = (uint32_t)ast->extra.count;
+    header.counts[SEC_NAMES] = (uint32_t)ast->names.count;
+    header.counts[SEC_NODE_SYMBOLS] = (uint32_t)ast->nodes.count;
+    header.counts[SEC_SYMBOLS] = (uint32_t)w.symbol_table.count;
+    header.counts[SEC_FRAMES] = (uint32_t)w.frame_table.count;
+    header.counts[SEC_CHECKED] = (uint32_t)symbols->count;
+    header.counts[SEC_STRINGS] = (uint32_t)w.offsets.count;
+    header.counts[SEC_TEXT] = (uint32_t)w.text.count;
+
+    const void *sections[AST_CACHE_SECTIONS] = {
+        ast->nodes.items, ast->extra.items, names,        node_symbols,    w.symbol_table.items,
+        w.frame_table.items, checked,       w.offsets.items, w.text.items,
+    };
+    size_t size = body_size(header.counts);
+    size_t at = 0;
+    char *body = arena_alloc(&arena, size);
+    memset(body, 0, size);
+    for (int s = 0; s < AST_CACHE_SECTIONS; s++)
+    {
+        if (header.counts[s])
+            memcpy(body + at, sections[s], header.counts[s] * section_item_size[s]);
+        at += section_size(header.counts, s);
+    }
+    header.checksum = hash_bytes(body, size);
+
+    // In the cache directory, so the rename cannot cross file systems
+    char *tmp = arena_sprintf(&arena, "%s.XXXXXX", path);
+    int fd = mkstemp(tmp);
+    FILE *file = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (fd >= 0 && file == NULL)
+    {
+        close(fd);
+        remove(tmp);
+    }
+    bool ok = file != NULL;
+    if (ok)
+    {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(body, 1, size, file) == size;
+        ok = !fclose(file) && ok && !rename(tmp, path);
+        if (!ok)
+            remove(tmp);
+    }
+    arena_stats_merge(&context_arena->stats, &arena.stats);
+    arena_free(&arena);
+    return ok;
+}
+
+static bool index_ok(uint32_t index, uint32_t count)
+{
+    return index <= count;
+}
+
+// Codegen follows the frame of every function and loads arguments from
+// one of a0 - a7
+static bool symbol_valid(const AstCacheSymbol *symbol)
+{
+    if (symbol->symbol > SYM_CONST || symbol->type > TS_FLOAT || symbol->is_arg_loaded > 1 || symbol->is_used > 1)
+        return false;
+    if (symbol->arg_reg < 0 || symbol->arg_reg >= 8)
+        return false;
+    return symbol->symbol != SYM_FUNCTION || symbol->frame != 0;
+}
+
+// Nodes sema_check() resolves must have a symbol, and the ones codegen
+// takes a frame from a function symbol. Run after ast_pool_valid().
+static bool node_symbols_valid(const AstPool *ast, const uint32_t *node_symbols, const AstCacheSymbol *symbols)
+{
+    for (AstRef ref = 1; ref < ast->nodes.count; ref++)
+    {
+        const AstNode *node = &ast->nodes.items[ref];
+        uint32_t symbol = node_symbols[ref];
+        switch (node->type)
+        {
+        case AST_FUNC_DEF:
+        case AST_FUNC_CALL:
+        case AST_RET:
+            if (symbol == 0 || symbols[symbol - 1].symbol != SYM_FUNCTION)
+                return false;
+            break;
+        case AST_PARAM:
+        case AST_VAR_DEF:
+        case AST_VAR_DEC:
+        case AST_IDENT:
+            if (symbol == 0)
+                return false;
+            break;
+        case AST_LVAL:
+            if (node_symbols[node->as.lval.ident] == 0)
+                return false;
+            break;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+// The file has to be written for this source by this version, and be
+// as long as its sections add up to
+static bool header_valid(const AstCacheHeader *header, size_t file_size, uint64_t source_hash, size_t source_length)
+{
+    AstCacheHeader expect;
+    header_init(&expect, source_hash, source_length);
+    if (memcmp(header, &expect, offsetof(AstCacheHeader, checksum)))
+        return false;
+    return body_size(header->counts) == file_size - sizeof(AstCacheHeader);
+}
+
+// Check the checksum and every index the loader follows into the
+// tables. Nodes and lists are checked by ast_pool_valid() and their
+// symbols by node_symbols_valid() once the pool is set up.
+static bool tables_valid(const AstCacheHeader *header, char *const *sections)
+{
+    const uint32_t *counts = header->counts;
+    if (hash_bytes(sections[0], body_size(counts)) != header->checksum)
+        return false;
+    if (counts[SEC_NODES] == 0 || counts[SEC_NODE_SYMBOLS] != counts[SEC_NODES] || counts[SEC_STRINGS] == 0)
+        return false;
+    if ((size_t)header->funcs >= counts[SEC_EXTRA] ||
+        header->funcs + 1 + (size_t)((uint32_t *)sections[SEC_EXTRA])[header->funcs] > counts[SEC_EXTRA])
+        return false;
+
+    const uint32_t *offsets = (uint32_t *)sections[SEC_STRINGS];
+    uint32_t strings = counts[SEC_STRINGS] - 1;
+    if (offsets[0] != 0 || offsets[strings] != counts[SEC_TEXT])
+        return false;
+    for (uint32_t i = 0; i < strings; i++)
+    {
+        if (offsets[i + 1] <= offsets[i] || sections[SEC_TEXT][offsets[i + 1] - 1] != '\0')
+            return false;
+    }
+
+    const uint32_t *names = (uint32_t *)sections[SEC_NAMES];
+    for (uint32_t i = 0; i < counts[SEC_NAMES]; i++)
+    {
+        if (names[i] == 0 || !index_ok(names[i], strings))
+            return false;
+    }
+    const uint32_t *node_symbols = (uint32_t *)sections[SEC_NODE_SYMBOLS];
+    for (uint32_t i = 0; i < counts[SEC_NODES]; i++)
+    {
+        if (!index_ok(node_symbols[i], counts[SEC_SYMBOLS]))
+            return false;
+    }
+    const AstCacheSymbol *symbols = (AstCacheSymbol *)sections[SEC_SYMBOLS];
+    for (uint32_t i = 0; i < counts[SEC_SYMBOLS]; i++)
+    {
+        if (!index_ok(symbols[i].key, strings) || !index_ok(symbols[i].frame, counts[SEC_FRAMES]))
+            return false;
+        if (!symbol_valid(&symbols[i]))
+            return false;
+    }
+    const AstCacheFrame *frames = (AstCacheFrame *)sections[SEC_FRAMES];
+    for (uint32_t i = 0; i < counts[SEC_FRAMES]; i++)
+    {
+        if (!index_ok(frames[i].func, strings))
+            return false;
+    }
+    const uint32_t *checked = (uint32_t *)sections[SEC_CHECKED];
+    for (uint32_t i = 0; i < counts[SEC_CHECKED]; i++)
+    {
+        if (checked[i] == 0 || !index_ok(checked[i], counts[SEC_SYMBOLS]))
+            return false;
+    }
+    return true;
+}
+
+// Map the cache file of a source back. The nodes and lists are used in
+// place, names are interned again and symbols rebuilt in the context
+// arena. 'symbols' gets what sema_check() returned when the file was
+// written. Returns NULL if there is no valid file for the source.
+AstPool *ast_cache_load(const char *path, uint64_t source_hash, size_t source_length, SymbolVec **symbols)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(AstCacheHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t file_size = st.st_size;
+    // Private and writable, the AST is mutable once loaded
+    char *data = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    AstCacheHeader *header = (AstCacheHeader *)data;
+    char *sections[AST_CACHE_SECTIONS];
+    bool valid = header_valid(header, file_size, source_hash, source_length);
+    if (valid)
+    {
+        char *at = data + sizeof(AstCacheHeader);
+        for (int s = 0; s < AST_CACHE_SECTIONS; s++)
+        {
+            sections[s] = at;
+            at += section_size(header->counts, s);
+        }
+        valid = tables_valid(header, sections);
+    }
+    if (!valid)
+    {
+        munmap(data, file_size);
+        return NULL;
+    }
+
+    const uint32_t *counts = header->counts;
+    const uint32_t *offsets = (uint32_t *)sections[SEC_STRINGS];
+    char **strings = context_alloc(counts[SEC_STRINGS] * sizeof(char *));
+    strings[0] = NULL;
+    for (uint32_t i = 1; i < counts[SEC_STRINGS]; i++)
+        strings[i] = intern(context_interns, sections[SEC_TEXT] + offsets[i - 1], offsets[i] - offsets[i - 1] - 1);
+
+    StackFrame **frames = context_alloc((counts[SEC_FRAMES] + 1) * sizeof(StackFrame *));
+    const AstCacheFrame *frame_table = (AstCacheFrame *)sections[SEC_FRAMES];
+    frames[0] = NULL;
+    for (uint32_t i = 1; i <= counts[SEC_FRAMES]; i++)
+    {
+        frames[i] = context_alloc(sizeof(StackFrame));
+        frames[i]->size = frame_table[i - 1].size;
+        frames[i]->func = strings[frame_table[i - 1].func];
+    }
+
+    SymTabEntry **entries = context_alloc((counts[SEC_SYMBOLS] + 1) * sizeof(SymTabEntry *));
+    const AstCacheSymbol *symbol_table = (AstCacheSymbol *)sections[SEC_SYMBOLS];
+    entries[0] = NULL;
+    for (uint32_t i = 1; i <= counts[SEC_SYMBOLS]; i++)
+    {
+        const AstCacheSymbol *in = &symbol_table[i - 1];
+        SymTabEntry *entry = make_symtab_entry(strings[in->key], (TypeSpecifier)in->type, (SymbolType)in->symbol);
+        entry->offset = in->offset;
+        entry->frame = frames[in->frame];
+        entry->param_count = in->param_count;
+        entry->const_value = in->const_value;
+        entry->arg_reg = in->arg_reg;
+        entry->is_arg_loaded = in->is_arg_loaded;
+        entry->is_used = in->is_used;
+        entries[i] = entry;
+    }
+
+    AstPool *ast = ast_pool_new(context_arena);
+    ast->nodes.items = (AstNode *)sections[SEC_NODES];
+    ast->nodes.count = ast->nodes.capacity = counts[SEC_NODES];
+    ast->extra.items = (uint32_t *)sections[SEC_EXTRA];
+    ast->extra.count = ast->extra.capacity = counts[SEC_EXTRA];
+    ast->funcs = header->funcs;
+    ast->mapping = data;
+    ast->mapping_size = file_size;
+
+    const uint32_t *names = (uint32_t *)sections[SEC_NAMES];
+    ast_pool_reserve_items(ast, 0, counts[SEC_NAMES], 0);
+    for (uint32_t i = 0; i < counts[SEC_NAMES]; i++)
+        ast->names.items[i] = strings[names[i]];
+    ast->names.count = counts[SEC_NAMES];
+    if (!ast_pool_valid(ast) ||
+        !node_symbols_valid(ast, (uint32_t *)sections[SEC_NODE_SYMBOLS], (AstCacheSymbol *)sections[SEC_SYMBOLS]))
+    {
+        ast_cache_close(ast);
+        return NULL;
+    }
+
+    const uint32_t *node_symbols = (uint32_t *)sections[SEC_NODE_SYMBOLS];
+    ast->symbols = arena_alloc(ast->arena, counts[SEC_NODES] * sizeof(SymTabEntry *));
+    for (uint32_t i = 0; i < counts[SEC_NODES]; i++)
+        ast->symbols[i] = entries[node_symbols[i]];
+
+    const uint32_t *checked = (uint32_t *)sections[SEC_CHECKED];
+    *symbols = context_alloc(sizeof(SymbolVec));
+    memset(*symbols, 0, sizeof(SymbolVec));
+    for (uint32_t i = 0; i < counts[SEC_CHECKED]; i++)
+        SymbolVec_push(*symbols, entries[checked[i]]);
+    return ast;
+}
+
+// Unmap the cache file a loaded pool points into, its nodes and lists
+// are gone afterwards
+void ast_cache_close(AstPool *ast)
+{
+    if (ast->mapping)
+        munmap(ast->mapping, ast->mapping_size);
+
+    ast->mapping = NULL;
+    ast->mapping_size = 0;
+}
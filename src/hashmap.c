@@ -1,5 +1,6 @@
 #include <mylang/arena.h>
 #include <mylang/hashmap.h>
+#include <mylang/intern.h>
 #include <mylang/util.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -10,7 +11,8 @@
 #define FNV_OFFSET 14695981039346656037UL
 #define FNV_PRIME 1099511628211UL
 
-#define TABLE_SIZE 100
+// Must be a power of two, buckets are picked by masking the hash
+#define TABLE_SIZE 128
 
 TypeEnvEntry *make_type_env_entry(char *value, TypeSpecifier ts)
 {
@@ -23,11 +25,10 @@ TypeEnvEntry *make_type_env_entry(char *value, TypeSpecifier ts)
 SymTabEntry *make_symtab_entry(char *key, TypeSpecifier type, SymbolType symbol)
 {
     SymTabEntry *entry = context_alloc(sizeof(SymTabEntry));
+    memset(entry, 0, sizeof(SymTabEntry));
     entry->key = key;
     entry->type = type;
     entry->symbol = symbol;
-    entry->is_arg_loaded = false;
-    entry->is_used = false;
     return entry;
 }
 
@@ -40,28 +41,38 @@ TableNode *make_table_node(TableNode *next, void *data, char *key)
     return node;
 }
 
-// Return 64-bit FNV-1a hash for key (NUL-terminated). See description:
+// Return 64-bit FNV-1a hash for data[0..length). See description:
 // https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function
 // https://benhoyt.com/writings/hash-table-in-c/
-static uint64_t hash(const char *key)
+uint64_t hash_bytes(const char *data, size_t length)
 {
     uint64_t hash = FNV_OFFSET;
-    for (const char *p = key; *p; p++)
+    for (size_t i = 0; i < length; i++)
     {
-        hash ^= (uint64_t)(unsigned char)(*p);
+        hash ^= (uint64_t)(unsigned char)data[i];
         hash *= FNV_PRIME;
     }
     return hash;
 }
 
+static uint64_t hash(HashMap *map, const char *key)
+{
+    return map->interned ? intern_hash(key) : hash_bytes(key, strlen(key));
+}
+
+static bool key_eq(HashMap *map, const char *a, const char *b)
+{
+    return map->interned ? a == b : !strcmp(a, b);
+}
+
 // Return matching entry for given key
 // or NULL otherwise if it does not exist
-void *find(TableNode *node, char *key)
+void *find(HashMap *map, TableNode *node, char *key)
 {
     TableNode *curr = node;
     while (curr != NULL)
     {
-        if (!strcmp(curr->key, key))
+        if (key_eq(map, curr->key, key))
         {
             return curr->data;
         }
@@ -71,7 +82,7 @@ void *find(TableNode *node, char *key)
 }
 
 // Insert node at end of list
-void insert(TableNode **index_node, void *data, char *key)
+void insert(HashMap *map, TableNode **index_node, void *data, char *key)
 {
 
     TableNode *n = make_table_node(NULL, data, key);
@@ -89,7 +100,7 @@ void insert(TableNode **index_node, void *data, char *key)
     TableNode *prev;
     while (curr != NULL)
     {
-        if (!strcmp(key, curr->key))
+        if (key_eq(map, key, curr->key))
         {
             curr->data = data;
             free(n);
@@ -107,19 +118,19 @@ void insert(TableNode **index_node, void *data, char *key)
 // Add symbol to table, overwrites matching key values
 void hashmap_add(HashMap *map, void *data, char *key)
 {
-    int h = hash(key);
+    uint64_t h = hash(map, key);
     size_t index = (size_t)(h & (uint64_t)(map->size - 1));
     TableNode **index_node = map->table + index;
-    insert(index_node, data, key);
+    insert(map, index_node, data, key);
 }
 
 // Return entry if it exists else null
 void *hashmap_get(HashMap *map, char *key)
 {
-    int h = hash(key);
+    uint64_t h = hash(map, key);
     size_t index = (size_t)(h & (uint64_t)(map->size - 1));
     TableNode **node = map->table + index;
-    return find(*node, key);
+    return find(map, *node, key);
 }
 
 HashMap *hashmap_new(void)
@@ -129,14 +140,24 @@ HashMap *hashmap_new(void)
 
     map->table = table;
     map->size = TABLE_SIZE;
+    map->interned = false;
 
     return map;
 }
 
+// Map whose keys all come from intern()
+HashMap *hashmap_new_interned(void)
+{
+    HashMap *map = hashmap_new();
+    map->interned = true;
+    return map;
+}
+
 // Creates a new shallow clone of table
 HashMap *symtab_clone(HashMap *symtab)
 {
     HashMap *clone = hashmap_new();
+    clone->interned = symtab->interned;
     for (size_t i = 0; i < symtab->size; i++)
     {
         TableNode *curr = symtab->table[i];
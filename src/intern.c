@@ -0,0 +1,138 @@
+#include <mylang/hashmap.h>
+#include <mylang/intern.h>
+#include <mylang/util.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_INIT_SIZE 1024
+
+// The text is stored right behind the header, so the header
+// can be found again from the interned pointer alone
+typedef struct InternEntry
+{
+    struct InternEntry *next;
+    uint64_t hash;
+    size_t length;
+    // Set by intern_merge(), the same name in the table merged into
+    char *merged;
+    char str[];
+} InternEntry;
+
+InternTable default_interns = {0};
+__thread InternTable *context_interns = &default_interns;
+
+static InternEntry *intern_entry(const char *name)
+{
+    return (InternEntry *)(name - offsetof(InternEntry, str));
+}
+
+// Double the bucket array, entries keep their hash so nothing is rehashed
+static void intern_grow(InternTable *table)
+{
+    size_t size = table->size ? table->size * 2 : INTERN_INIT_SIZE;
+    InternEntry **buckets = calloc(size, sizeof(InternEntry *));
+    if (buckets == NULL)
+    {
+        perror("Failed to allocate memory.");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < table->size; i++)
+    {
+        InternEntry *curr = table->buckets[i];
+        while (curr)
+        {
+            InternEntry *next = curr->next;
+            InternEntry **slot = buckets + (curr->hash & (size - 1));
+            curr->next = *slot;
+            *slot = curr;
+            curr = next;
+        }
+    }
+
+    free(table->buckets);
+    table->buckets = buckets;
+    table->size = size;
+}
+
+static char *intern_hashed(InternTable *table, const char *str, size_t length, uint64_t h)
+{
+    // context_interns on a worker thread of run_parallel()
+    if (table == NULL)
+    {
+        fprintf(stderr, "my-lang: no intern table to intern '%.*s' into on this thread\n", (int)length, str);
+        exit(1);
+    }
+    if (table->size != 0)
+    {
+        for (InternEntry *curr = table->buckets[h & (table->size - 1)]; curr; curr = curr->next)
+        {
+            if (curr->hash == h && curr->length == length && !memcmp(curr->str, str, length))
+                return curr->str;
+        }
+    }
+
+    // Keep the load factor under 3/4
+    if ((table->count + 1) * 4 > table->size * 3)
+        intern_grow(table);
+
+    InternEntry *entry = arena_alloc(&table->arena, sizeof(InternEntry) + length + 1);
+    entry->hash = h;
+    entry->length = length;
+    entry->merged = NULL;
+    memcpy(entry->str, str, length);
+    entry->str[length] = '\0';
+
+    InternEntry **slot = table->buckets + (h & (table->size - 1));
+    entry->next = *slot;
+    *slot = entry;
+    table->count++;
+    return entry->str;
+}
+
+// Returns the canonical NUL-terminated copy of str[0..length)
+char *intern(InternTable *table, const char *str, size_t length)
+{
+    return intern_hashed(table, str, length, hash_bytes(str, length));
+}
+
+char *intern_cstr(InternTable *table, const char *str)
+{
+    return intern(table, str, strlen(str));
+}
+
+uint64_t intern_hash(const char *name)
+{
+    return intern_entry(name)->hash;
+}
+
+size_t intern_length(const char *name)
+{
+    return intern_entry(name)->length;
+}
+
+// Intern every name of 'from' into 'into'. Afterwards intern_resolve()
+// maps names from 'from' to their copy in 'into'.
+void intern_merge(InternTable *into, InternTable *from)
+{
+    for (size_t i = 0; i < from->size; i++)
+    {
+        for (InternEntry *curr = from->buckets[i]; curr; curr = curr->next)
+            curr->merged = intern_hashed(into, curr->str, curr->length, curr->hash);
+    }
+}
+
+char *intern_resolve(const char *name)
+{
+    return intern_entry(name)->merged;
+}
+
+void intern_free(InternTable *table)
+{
+    arena_free(&table->arena);
+    free(table->buckets);
+    table->buckets = NULL;
+    table->size = 0;
+    table->count = 0;
+}
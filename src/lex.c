@@ -1,4 +1,4 @@
-#include <ctype.h>
+#include <mylang/intern.h>
 #include <mylang/lex.h>
 #include <mylang/util.h>
 #include <stdio.h>
@@ -30,319 +30,516 @@ char *read_file(char *filename, size_t *length)
     return buffer;
 }
 
-// Parse each character in input and
-// return a Vector of tokens from contents
-Vector *tokenize(const char *input, size_t length)
+// Character classes used by the scanner, a byte can be in several
+enum
 {
-    char c;
-    Vector *vector = vector_new();
+    CC_SPACE = 1 << 0,
+    CC_NEWLINE = 1 << 1,
+    CC_IDENT_START = 1 << 2,
+    CC_IDENT = 1 << 3,
+    CC_DIGIT = 1 << 4,
+    CC_PUNCT = 1 << 5,
+};
+
+#define S CC_SPACE
+#define N CC_NEWLINE
+#define A (CC_IDENT_START | CC_IDENT)
+#define D (CC_DIGIT | CC_IDENT)
+#define P CC_PUNCT
+
+// Class of every byte value, 0 for bytes that cannot start a token
+static const unsigned char char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, S, N, 0, 0, 0, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    S, P, 0, 0, 0, 0, P, 0, P, P, P, P, P, P, 0, P, // 0x20  !"#$%&'()*+,-./
+    D, D, D, D, D, D, D, D, D, D, 0, P, P, P, P, 0, // 0x30 0123456789:;<=>?
+    0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, // 0x40 @ABCDEFGHIJKLMNO
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, P, A, // 0x50 PQRSTUVWXYZ[\]^_
+    0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, // 0x60 `abcdefghijklmno
+    A, A, A, A, A, A, A, A, A, A, A, P, P, P, 0, 0, // 0x70 pqrstuvwxyz{|}~
+};
+
+#undef S
+#undef N
+#undef A
+#undef D
+#undef P
+
+// Operator starting with a given character, extended by maximal munch
+// to a two character operator if the next byte is one of 'follow'
+typedef struct OpRule
+{
+    TokenType type;
+    char follow[2];
+    TokenType follow_type[2];
+} OpRule;
+
+static const OpRule op_rules[256] = {
+    ['+'] = {TOK_ADD, {0}, {0}},
+    ['-'] = {TOK_SUB, {0}, {0}},
+    ['*'] = {TOK_MULT, {0}, {0}},
+    ['/'] = {TOK_DIV, {0}, {0}},
+    [';'] = {TOK_SEMICOLON, {0}, {0}},
+    ['('] = {TOK_LPAREN, {0}, {0}},
+    [')'] = {TOK_RPAREN, {0}, {0}},
+    ['{'] = {TOK_LBRACE, {0}, {0}},
+    ['}'] = {TOK_RBRACE, {0}, {0}},
+    ['^'] = {TOK_XOR, {0}, {0}},
+    [','] = {TOK_COMMA, {0}, {0}},
+    ['&'] = {TOK_AND, {'&'}, {TOK_LOG_AND}},
+    ['|'] = {TOK_OR, {'|'}, {TOK_LOG_OR}},
+    ['='] = {TOK_ASSIGN, {'='}, {TOK_EQUAL}},
+    ['!'] = {TOK_NOT, {'='}, {TOK_NOT_EQUAL}},
+    ['<'] = {TOK_LT, {'<', '='}, {TOK_LSHIFT, TOK_LT_EQ}},
+    ['>'] = {TOK_GT, {'>', '='}, {TOK_RSHIFT, TOK_GT_EQ}},
+};
+
+void lexer_init(Lexer *lexer, const char *input, size_t length)
+{
+    // Token offsets and lengths are stored in 32 bits
+    if (length > UINT32_MAX)
+    {
+        fprintf(stderr, "Source files larger than 4 GiB are not supported\n");
+        exit(1);
+    }
 
-    Lexer *lexer = (Lexer *)context_alloc(sizeof(Lexer));
-    lexer->curr = 0;
     lexer->input = input;
+    lexer->curr = 0;
     lexer->length = length;
+    lexer->scan = scan_kernels();
+    lexer->interns = context_interns;
+}
+
+// Runs shorter than this are finished inline, the vector
+// kernels only pay off for the long ones
+#define SCAN_INLINE_BYTES 16
 
-    int pos = 1;
-    int line = 1;
-    char peek;
-    while ((c = next(lexer)))
+// Returns the index after the "*/" closing the comment that starts at i
+static size_t skip_block_comment(Lexer *lexer, size_t i)
+{
+    size_t end = lexer->scan->comment_end(lexer->input, i + 2, lexer->length);
+    if (end == lexer->length)
     {
-        Token *t = (Token *)context_alloc(sizeof(Token));
-        switch (c)
-        {
-        case '+':
-            t->type = TOK_ADD;
-            t->value = string("+");
-            break;
-        case '-':
-            t->type = TOK_SUB;
-            t->value = string("-");
-            break;
-        case '*':
-            t->type = TOK_MULT;
-            t->value = string("*");
-            break;
-        case '/':
-            // Handle Comments
-            if ((peek = next(lexer)) == '/')
-            {
-                while ((peek = next(lexer)) && peek != '\n')
-                    ;
-
-                c = peek;
-                line += 1;
-                pos = 1;
-            }
-            else
-            {
-                back(lexer);
-                t->type = TOK_DIV;
-                t->value = string("/");
-            }
-            break;
-        case ';':
-            t->type = TOK_SEMICOLON;
-            t->value = string(";");
-            break;
-        case '(':
-            t->type = TOK_LPAREN;
-            t->value = string("(");
-            break;
-        case ')':
-            t->type = TOK_RPAREN;
-            t->value = string(")");
-            break;
-        case '{':
-            t->type = TOK_LBRACE;
-            t->value = string("{");
-            break;
-        case '}':
-            t->type = TOK_RBRACE;
-            t->value = string("}");
-            break;
-        case '^':
-            t->type = TOK_XOR;
-            t->value = string("^");
-            break;
-        case '&':
-            if ((peek = next(lexer)) != '&')
-            {
-
-                t->type = TOK_AND;
-                t->value = string("&");
-                back(lexer);
-            }
-            else
-            {
-                t->type = TOK_LOG_AND;
-                t->value = string("&&");
-            }
-            break;
-        case '|':
-            if ((peek = next(lexer)) != '|')
-            {
-                t->type = TOK_OR;
-                t->value = string("|");
-                back(lexer);
-            }
-            else
-            {
-                t->type = TOK_LOG_OR;
-                t->value = string("||");
-            }
-            break;
-        case '=':
-            if ((peek = next(lexer)) == '=')
-            {
-                t->type = TOK_EQUAL;
-                t->value = string("==");
-            }
-            else
-            {
-                back(lexer);
-                t->type = TOK_ASSIGN;
-                t->value = string("=");
-            }
-            break;
-        case '!':
-            if ((peek = next(lexer)) == '=')
-            {
-                t->type = TOK_NOT_EQUAL;
-                t->value = string("!=");
-            }
-            else
-            {
-                back(lexer);
-                t->type = TOK_NOT;
-                t->value = string("!");
-            }
-            break;
-        case '<':
-            peek = next(lexer);
-            if (peek == '<')
-            {
-                t->type = TOK_LSHIFT;
-                t->value = string("<<");
-            }
-            else if (peek == '=')
-            {
-
-                t->type = TOK_LT_EQ;
-                t->value = string("<=");
-            }
-            else
-            {
-                t->type = TOK_LT;
-                t->value = string("<");
-                back(lexer);
-            }
-            break;
-        case '>':
-            peek = next(lexer);
-            if (peek == '>')
-            {
-                t->type = TOK_RSHIFT;
-                t->value = string(">>");
-            }
-            else if (peek == '=')
-            {
-
-                t->type = TOK_GT_EQ;
-                t->value = string(">=");
-            }
-            else
-            {
-                t->type = TOK_GT;
-                t->value = string(">");
-                back(lexer);
-            }
-            break;
-        case ',':
-            t->type = TOK_COMMA;
-            t->value = string(",");
-            break;
-        case '\n':
-            line += 1;
-            pos = 1;
-            break;
-        case '\t':
-        case ' ':
+        SourcePos pos = source_pos(lexer->input, lexer->length, i);
+        fprintf(stderr, "Unterminated comment at line: %d, column: %d\n", pos.line, pos.column);
+        exit(1);
+    }
+    return end + 2;
+}
+
+// Skip whitespace and comments in front of the next token
+static void skip_blank(Lexer *lexer)
+{
+    const unsigned char *input = (const unsigned char *)lexer->input;
+    size_t i = lexer->curr;
+    size_t length = lexer->length;
+
+    while (i < length)
+    {
+        unsigned char cls = char_class[input[i]];
+        if (cls & CC_SPACE)
+            i++;
+        // Indentation after a newline is a run worth handing to the kernel
+        else if (cls & CC_NEWLINE)
+            i = lexer->scan->blank(lexer->input, i, length);
+        // Comment runs up to the newline
+        else if (input[i] == '/' && i + 1 < length && input[i + 1] == '/')
+            i = lexer->scan->line_end(lexer->input, i + 2, length);
+        // Block comments can be long, the line index finds their newlines later
+        else if (input[i] == '/' && i + 1 < length && input[i + 1] == '*')
+            i = skip_block_comment(lexer, i);
+        else
             break;
-        default:
-
-            if (isdigit(c))
-            {
-                tokenize_digit(c, t, lexer);
-                break;
-            }
-
-            if (is_ident_start(c))
-            {
-                tokenize_ident(c, t, lexer);
-                break;
-            }
-            printf("%c\n", c);
-            perror("Unexpected char.");
-            exit(1);
-        }
-        t->pos = pos;
-        t->line = line;
-        pos += 1;
-        if (c != ' ' && c != '\n' && c != '\t')
-        {
-            vector_push(vector, (void *)t);
-        }
     }
-    return vector;
+    lexer->curr = i;
 }
 
-// Parse digit token
-void tokenize_digit(char c, Token *token, Lexer *lexer)
+// Scan the next token into 'token'
+// Returns false once the end of input is reached
+bool lex_token(Lexer *lexer, Token *token)
 {
-    int size = 1;
-    int digit = 0;
-    int multiplier = 10;
-    while (c && isdigit(c))
+    skip_blank(lexer);
+    if (lexer->curr >= lexer->length)
+        return false;
+
+    unsigned char c = (unsigned char)lexer->input[lexer->curr];
+    unsigned char cls = char_class[c];
+
+    token->offset = lexer->curr;
+    token->ident = NULL;
+    token->suffix = 0;
+
+    if (cls & CC_IDENT_START)
+        tokenize_ident(lexer, token);
+    else if (cls & CC_DIGIT)
+        tokenize_digit(lexer, token);
+    else if (cls & CC_PUNCT)
+        tokenize_operator(lexer, token);
+    else
     {
-        digit *= multiplier;
-        digit += c - '0';
-        c = next(lexer);
-        size += 1;
+        printf("%c\n", c);
+        perror("Unexpected char.");
+        exit(1);
     }
-    // Put back last char if end of stream
-    if (c != '\0')
+    token->length = lexer->curr - token->offset;
+    return true;
+}
+
+TokenBuffer *token_buffer_new_in(Arena *arena, const char *input, size_t input_length, size_t capacity)
+{
+    TokenBuffer *tokens = arena_alloc(arena, sizeof(TokenBuffer));
+    tokens->arena = arena;
+    tokens->input = input;
+    tokens->input_length = input_length;
+    tokens->count = 0;
+    tokens->capacity = capacity;
+    tokens->types = arena_alloc(arena, capacity * sizeof(uint8_t));
+    tokens->offsets = arena_alloc(arena, capacity * sizeof(uint32_t));
+    tokens->lengths = arena_alloc(arena, capacity * sizeof(uint32_t));
+    tokens->values = arena_alloc(arena, capacity * sizeof(TokenValue));
+    tokens->suffixes = arena_alloc(arena, capacity * sizeof(uint8_t));
+    return tokens;
+}
+
+TokenBuffer *token_buffer_new(const char *input, size_t input_length, size_t capacity)
+{
+    return token_buffer_new_in(context_arena, input, input_length, capacity);
+}
+
+#define TOKEN_BUFFER_GROW(tokens, field, capacity)                                                                     \
+    (tokens)->field = arena_realloc((tokens)->arena, (tokens)->field, (tokens)->capacity * sizeof(*(tokens)->field),   \
+                                    (capacity) * sizeof(*(tokens)->field))
+
+static void token_buffer_grow(TokenBuffer *tokens, size_t capacity)
+{
+    TOKEN_BUFFER_GROW(tokens, types, capacity);
+    TOKEN_BUFFER_GROW(tokens, offsets, capacity);
+    TOKEN_BUFFER_GROW(tokens, lengths, capacity);
+    TOKEN_BUFFER_GROW(tokens, values, capacity);
+    TOKEN_BUFFER_GROW(tokens, suffixes, capacity);
+    tokens->capacity = capacity;
+}
+
+#undef TOKEN_BUFFER_GROW
+
+// Make room for at least capacity tokens
+void token_buffer_reserve(TokenBuffer *tokens, size_t capacity)
+{
+    size_t grown = tokens->capacity ? tokens->capacity : ARENA_DA_INIT_CAP;
+    while (grown < capacity)
+        grown *= 2;
+    if (grown > tokens->capacity)
+        token_buffer_grow(tokens, grown);
+}
+
+// Store token in slot index, which must be below capacity
+void token_buffer_set(TokenBuffer *tokens, size_t index, const Token *token)
+{
+    tokens->types[index] = (uint8_t)token->type;
+    tokens->offsets[index] = (uint32_t)token->offset;
+    tokens->lengths[index] = (uint32_t)token->length;
+    if (token->type == TOK_NUM)
+        tokens->values[index].value = token->value;
+    else
+        tokens->values[index].ident = token->ident;
+    tokens->suffixes[index] = token->suffix;
+}
+
+void token_buffer_push(TokenBuffer *tokens, const Token *token)
+{
+    if (tokens->count == tokens->capacity)
+        token_buffer_grow(tokens, tokens->capacity ? tokens->capacity * 2 : ARENA_DA_INIT_CAP);
+    token_buffer_set(tokens, tokens->count++, token);
+}
+
+// Unpack the token in slot index
+Token token_at(const TokenBuffer *tokens, size_t index)
+{
+    Token token;
+    token.type = (TokenType)tokens->types[index];
+    token.offset = tokens->offsets[index];
+    token.length = tokens->lengths[index];
+    token.ident = token.type == TOK_NUM ? NULL : tokens->values[index].ident;
+    token.value = token.type == TOK_NUM ? tokens->values[index].value : 0;
+    token.suffix = tokens->suffixes[index];
+    return token;
+}
+
+// Lex the whole input into a token buffer
+TokenBuffer *tokenize(const char *input, size_t length)
+{
+    TokenBuffer *tokens = token_buffer_new(input, length, ARENA_DA_INIT_CAP);
+    Lexer lexer;
+    Token token;
+
+    lexer_init(&lexer, input, length);
+    while (lex_token(&lexer, &token))
+        token_buffer_push(tokens, &token);
+
+    return tokens;
+}
+
+// Parse operator or punctuation token
+void tokenize_operator(Lexer *lexer, Token *token)
+{
+    const OpRule *rule = &op_rules[(unsigned char)lexer->input[lexer->curr]];
+    lexer->curr++;
+
+    token->type = rule->type;
+    if (lexer->curr >= lexer->length)
+        return;
+
+    char c = lexer->input[lexer->curr];
+    for (int i = 0; i < 2 && rule->follow[i]; i++)
     {
-        back(lexer);
+        if (c == rule->follow[i])
+        {
+            token->type = rule->follow_type[i];
+            lexer->curr++;
+            return;
+        }
     }
-    char *value = int_to_str(digit, size);
-    token->value = string(value);
-    token->type = TOK_NUM;
 }
 
-// Parse Identifier token
-void tokenize_ident(char c, Token *token, Lexer *lexer)
+// Value of a digit in bases up to 16, 16 for any other byte
+static unsigned digit_value(unsigned char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return 16;
+}
+
+static void number_error(Lexer *lexer, Token *token, const char *message)
+{
+    SourcePos pos = source_pos(lexer->input, lexer->length, token->offset);
+    fprintf(stderr, "%s at line: %d, column: %d\n", message, pos.line, pos.column);
+    exit(1);
+}
+
+// Parse an integer constant: decimal, octal with a leading 0,
+// hex with 0x or binary with 0b, followed by an optional suffix.
+// The value is computed while scanning and must fit in 64 bits.
+void tokenize_digit(Lexer *lexer, Token *token)
 {
-    String *ident = string_new();
-    while (c && is_ident_char(c))
+    const unsigned char *input = (const unsigned char *)lexer->input;
+    size_t i = lexer->curr;
+    size_t length = lexer->length;
+    unsigned base = 10;
+    uint64_t value = 0;
+    unsigned d;
+
+    if (input[i] == '0' && i + 1 < length)
     {
-        string_append(ident, c);
-        c = next(lexer);
+        unsigned char prefix = input[i + 1] | 0x20;
+        if (prefix == 'x' || prefix == 'b')
+        {
+            base = prefix == 'x' ? 16 : 2;
+            i += 2;
+            if (i >= length || digit_value(input[i]) >= base)
+                number_error(lexer, token, "Integer constant has no digits");
+        }
+        else
+            base = 8;
     }
 
-    // Put back last char if end of stream
-    if (c != '\0')
+    while (i < length && (d = digit_value(input[i])) < base)
     {
-        back(lexer);
+        if (value > (UINT64_MAX - d) / base)
+            number_error(lexer, token, "Integer constant is too large");
+        value = value * base + d;
+        i++;
     }
+    if (i < length && digit_value(input[i]) < 10)
+        number_error(lexer, token, base == 8 ? "Invalid digit in octal constant" : "Invalid digit in binary constant");
 
-    token->value = ident;
-    token->type = TOK_IDENT;
-
-    // Handle Keywords
-    if (string_eq(ident, "int"))
-        token->type = TOK_TYPE;
-    else if (string_eq(ident, "void"))
-        token->type = TOK_TYPE;
-    else if (string_eq(ident, "return"))
-        token->type = TOK_RETURN;
-    else if (string_eq(ident, "if"))
-        token->type = TOK_IF;
-    else if (string_eq(ident, "else"))
-        token->type = TOK_ELSE;
-    else if (string_eq(ident, "enum"))
-        token->type = TOK_ENUM;
-    else if (string_eq(ident, "while"))
-        token->type = TOK_WHILE;
-    else if (string_eq(ident, "for"))
-        token->type = TOK_FOR;
+    unsigned char suffix = 0;
+    if (i < length && (input[i] | 0x20) == 'u')
+    {
+        suffix |= NUM_UNSIGNED;
+        i++;
+    }
+    if (i < length && (input[i] | 0x20) == 'l')
+    {
+        // 'll' and 'LL' but not 'lL'
+        i++;
+        if (i < length && input[i] == input[i - 1])
+        {
+            suffix |= NUM_LONG_LONG;
+            i++;
+        }
+        else
+            suffix |= NUM_LONG;
+    }
+    if (!(suffix & NUM_UNSIGNED) && i < length && (input[i] | 0x20) == 'u')
+    {
+        suffix |= NUM_UNSIGNED;
+        i++;
+    }
+    if (i < length && (char_class[input[i]] & CC_IDENT))
+        number_error(lexer, token, "Invalid suffix on integer constant");
+
+    lexer->curr = i;
+    token->type = TOK_NUM;
+    token->value = value;
+    token->suffix = suffix;
 }
 
-// Put back character in stream
-void back(Lexer *lexer)
+typedef struct Keyword
+{
+    const char *name;
+    size_t length;
+    TokenType type;
+} Keyword;
+
+// Keywords placed at their perfect hash slot. Two keywords landing on
+// the same slot override each other, which -Woverride-init turns into
+// a build error, so adding a keyword is one row here.
+#define KEYWORD(name, first, last, type) [KEYWORD_HASH(sizeof(name) - 1, first, last)] = {name, sizeof(name) - 1, type}
+
+static const Keyword keywords[KEYWORD_TABLE_SIZE] = {
+    KEYWORD("int", 'i', 't', TOK_TYPE),       KEYWORD("void", 'v', 'd', TOK_TYPE),
+    KEYWORD("char", 'c', 'r', TOK_TYPE),      KEYWORD("long", 'l', 'g', TOK_TYPE),
+    KEYWORD("float", 'f', 't', TOK_TYPE),     KEYWORD("double", 'd', 'e', TOK_TYPE),
+    KEYWORD("return", 'r', 'n', TOK_RETURN),  KEYWORD("if", 'i', 'f', TOK_IF),
+    KEYWORD("else", 'e', 'e', TOK_ELSE),      KEYWORD("enum", 'e', 'm', TOK_ENUM),
+    KEYWORD("while", 'w', 'e', TOK_WHILE),    KEYWORD("for", 'f', 'r', TOK_FOR),
+};
+
+#undef KEYWORD
+
+// Returns the keyword token type for an identifier, TOK_IDENT otherwise
+TokenType keyword_lookup(const char *ident, size_t length)
 {
-    lexer->curr--;
+    const Keyword *keyword =
+        &keywords[KEYWORD_HASH(length, (unsigned char)ident[0], (unsigned char)ident[length - 1])];
+    if (keyword->length == length && !memcmp(keyword->name, ident, length))
+        return keyword->type;
+    return TOK_IDENT;
 }
 
-// Get next character in stream
-char next(Lexer *lexer)
+// Parse Identifier token
+void tokenize_ident(Lexer *lexer, Token *token)
 {
-    if (lexer->curr >= lexer->length)
-    {
-        return '\0';
-    }
-    return lexer->input[lexer->curr++];
+    const unsigned char *input = (const unsigned char *)lexer->input;
+    const char *ident = lexer->input + lexer->curr;
+    size_t i = lexer->curr;
+    size_t limit = i + SCAN_INLINE_BYTES < lexer->length ? i + SCAN_INLINE_BYTES : lexer->length;
+    while (i < limit && (char_class[input[i]] & CC_IDENT))
+        i++;
+    if (i == limit)
+        i = lexer->scan->ident(lexer->input, i, lexer->length);
+
+    size_t length = i - lexer->curr;
+    lexer->curr = i;
+
+    token->type = keyword_lookup(ident, length);
+    if (token->type == TOK_IDENT || token->type == TOK_TYPE)
+        token->ident = intern(lexer->interns, ident, length);
 }
 
-Token *make_token(int type, String *value, int pos, int line)
+Token *make_token(int type, size_t offset, size_t length)
 {
     Token *t;
     t = my_malloc(sizeof(Token));
 
     t->type = type;
-    t->value = value;
-    t->pos = pos;
-    t->line = line;
+    t->offset = offset;
+    t->length = length;
+    t->ident = NULL;
+    t->value = 0;
+    t->suffix = 0;
     return t;
 }
 
-void dump_tokens(Vector *tokens)
+// Returns the fixed spelling of operator and punctuation tokens,
+// NULL for tokens whose text depends on the source
+const char *token_spelling(TokenType type)
 {
-    for (size_t i = 0; i < tokens->length; i++)
-        print_token((Token *)vector_get(tokens, i));
+    switch (type)
+    {
+    case TOK_ADD:
+        return "+";
+    case TOK_SUB:
+        return "-";
+    case TOK_MULT:
+        return "*";
+    case TOK_DIV:
+        return "/";
+    case TOK_LBRACKET:
+        return "[";
+    case TOK_RBRACKET:
+        return "]";
+    case TOK_LPAREN:
+        return "(";
+    case TOK_RPAREN:
+        return ")";
+    case TOK_LBRACE:
+        return "{";
+    case TOK_RBRACE:
+        return "}";
+    case TOK_SEMICOLON:
+        return ";";
+    case TOK_ASSIGN:
+        return "=";
+    case TOK_COMMA:
+        return ",";
+    case TOK_EQUAL:
+        return "==";
+    case TOK_NOT_EQUAL:
+        return "!=";
+    case TOK_NOT:
+        return "!";
+    case TOK_AND:
+        return "&";
+    case TOK_OR:
+        return "|";
+    case TOK_XOR:
+        return "^";
+    case TOK_LOG_OR:
+        return "||";
+    case TOK_LOG_AND:
+        return "&&";
+    case TOK_LSHIFT:
+        return "<<";
+    case TOK_RSHIFT:
+        return ">>";
+    case TOK_GT:
+        return ">";
+    case TOK_LT:
+        return "<";
+    case TOK_GT_EQ:
+        return ">=";
+    case TOK_LT_EQ:
+        return "<=";
+    default:
+        return NULL;
+    }
 }
 
-void print_token(Token *t)
+// Copy token text out of the source into a NUL-terminated string
+char *token_str(const char *input, Token *t)
 {
-    char *str = as_str(t->value);
-    printf("<TOKEN TYPE=%d VALUE=%s POS=%d LINE=%d>\n", t->type, str, t->pos, t->line);
+    char *str = (char *)context_alloc(t->length + 1);
+    memcpy(str, input + t->offset, t->length);
+    str[t->length] = '\0';
+    return str;
 }
 
-int is_ident_char(char c)
+void dump_tokens(TokenBuffer *tokens)
 {
-    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+    LineIndex *lines = line_index_new(tokens->input, tokens->input_length);
+    for (size_t i = 0; i < tokens->count; i++)
+    {
+        Token token = token_at(tokens, i);
+        print_token(tokens->input, &token, line_index_lookup(lines, token.offset));
+    }
 }
 
-int is_ident_start(char c)
+void print_token(const char *input, Token *t, SourcePos pos)
 {
-    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+    printf("<TOKEN TYPE=%d VALUE=%.*s POS=%d LINE=%d>\n", t->type, (int)t->length, input + t->offset, pos.column,
+           pos.line);
 }
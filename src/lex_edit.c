@@ -0,0 +1,95 @@
+#include <mylang/arena.h>
+#include <mylang/lex.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define TOKEN_BUFFER_MOVE(tokens, field, to, from, count)                                                              \
+    memmove((tokens)->field + (to), (tokens)->field + (from), (count) * sizeof(*(tokens)->field))
+
+// Index of the first token that does not end before offset
+static size_t first_touching(const TokenBuffer *tokens, size_t offset)
+{
+    size_t lo = 0;
+    size_t hi = tokens->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((size_t)tokens->offsets[mid] + tokens->lengths[mid] < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Replace tokens [from, to) with the tokens in fresh
+static void splice(TokenBuffer *tokens, size_t from, size_t to, const TokenBuffer *fresh)
+{
+    size_t tail = tokens->count - to;
+    size_t at = from + fresh->count;
+
+    token_buffer_reserve(tokens, at + tail);
+    TOKEN_BUFFER_MOVE(tokens, types, at, to, tail);
+    TOKEN_BUFFER_MOVE(tokens, offsets, at, to, tail);
+    TOKEN_BUFFER_MOVE(tokens, lengths, at, to, tail);
+    TOKEN_BUFFER_MOVE(tokens, values, at, to, tail);
+    TOKEN_BUFFER_MOVE(tokens, suffixes, at, to, tail);
+
+    memcpy(tokens->types + from, fresh->types, fresh->count * sizeof(*fresh->types));
+    memcpy(tokens->offsets + from, fresh->offsets, fresh->count * sizeof(*fresh->offsets));
+    memcpy(tokens->lengths + from, fresh->lengths, fresh->count * sizeof(*fresh->lengths));
+    memcpy(tokens->values + from, fresh->values, fresh->count * sizeof(*fresh->values));
+    memcpy(tokens->suffixes + from, fresh->suffixes, fresh->count * sizeof(*fresh->suffixes));
+    tokens->count = at + tail;
+}
+
+// Update tokens, lexed from the text before edit, to match input.
+// Lexing restarts after the last token that ends before the edit and
+// stops as soon as a token starts where an old one did in the unchanged
+// text behind the edit. From a position outside any comment the lexer
+// only depends on the text ahead, so every later token is the same and
+// only has its offset shifted. Returns the number of tokens lexed.
+size_t token_buffer_edit(TokenBuffer *tokens, const char *input, size_t input_length, TextEdit edit)
+{
+    size_t keep = first_touching(tokens, edit.start);
+    size_t resume = keep ? tokens->offsets[keep - 1] + tokens->lengths[keep - 1] : 0;
+    size_t old = keep;
+    bool synced = false;
+
+    Arena scratch = {0};
+    TokenBuffer *fresh = token_buffer_new_in(&scratch, input, input_length, ARENA_DA_INIT_CAP);
+    Lexer lexer;
+    Token token;
+
+    lexer_init(&lexer, input, input_length);
+    lexer.curr = resume;
+    while (lex_token(&lexer, &token))
+    {
+        if (token.offset >= edit.new_end)
+        {
+            size_t target = token.offset - edit.new_end + edit.old_end;
+            while (old < tokens->count && tokens->offsets[old] < target)
+                old++;
+            if (old < tokens->count && tokens->offsets[old] == target)
+            {
+                synced = true;
+                break;
+            }
+        }
+        token_buffer_push(fresh, &token);
+    }
+    if (!synced)
+        old = tokens->count;
+
+    splice(tokens, keep, old, fresh);
+    for (size_t i = keep + fresh->count; i < tokens->count; i++)
+        tokens->offsets[i] = (uint32_t)(tokens->offsets[i] - edit.old_end + edit.new_end);
+    tokens->input = input;
+    tokens->input_length = input_length;
+
+    size_t lexed = fresh->count + synced;
+    arena_free(&scratch);
+    return lexed;
+}
+
+#undef TOKEN_BUFFER_MOVE
@@ -0,0 +1,170 @@
+#include <mylang/intern.h>
+#include <mylang/lex.h>
+#include <mylang/scan.h>
+#include <mylang/util.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A byte range of the input lexed by one thread
+typedef struct LexChunk
+{
+    const char *input;
+    size_t input_length;
+    // Range [start, end), both are line starts outside any comment
+    size_t start;
+    size_t end;
+
+    // Only touched by the thread lexing the chunk
+    Arena arena;
+    InternTable interns;
+    TokenBuffer *tokens;
+
+    // Where the chunk's tokens are copied to in the stitched buffer
+    TokenBuffer *out;
+    size_t out_index;
+} LexChunk;
+
+// Number of chunks worth lexing in parallel, 1 for small inputs
+int lex_chunk_count(size_t input_length, int jobs)
+{
+    size_t chunks = input_length / LEX_CHUNK_MIN;
+    if (jobs < 1)
+        jobs = 1;
+    if (chunks > (size_t)jobs)
+        chunks = jobs;
+    return chunks ? (int)chunks : 1;
+}
+
+// Advance from i, which is outside any comment, to at least target.
+// Comments are stepped over as a whole, so the result is never inside one.
+static size_t skip_to(const ScanKernels *scan, const char *input, size_t length, size_t i, size_t target)
+{
+    while (i < target)
+    {
+        const char *slash = memchr(input + i, '/', target - i);
+        if (slash == NULL)
+            return target;
+
+        i = slash - input + 1;
+        if (i < length && input[i] == '*')
+        {
+            i = scan->comment_end(input, i + 1, length);
+            i = i < length ? i + 2 : length;
+        }
+        else if (i < length && input[i] == '/')
+            i = scan->line_end(input, i + 1, length);
+    }
+    return i;
+}
+
+// Start of the first line after target whose preceding newline lies
+// outside every comment. 'from' is a previous split, so it is outside too.
+static size_t find_split(const ScanKernels *scan, const char *input, size_t length, size_t from, size_t target)
+{
+    size_t i = skip_to(scan, input, length, from, target);
+    while (i < length)
+    {
+        size_t newline = scan->line_end(input, i, length);
+        if (newline >= length)
+            break;
+
+        // A block comment opened on this line may run past the newline
+        i = skip_to(scan, input, length, i, newline);
+        if (i == newline)
+            return newline + 1;
+    }
+    return length;
+}
+
+static void *lex_chunk(void *arg)
+{
+    LexChunk *chunk = arg;
+    Lexer lexer;
+    Token token;
+
+    lexer_init(&lexer, chunk->input, chunk->end);
+    lexer.curr = chunk->start;
+    lexer.interns = &chunk->interns;
+
+    chunk->tokens = token_buffer_new_in(&chunk->arena, chunk->input, chunk->input_length, ARENA_DA_INIT_CAP);
+    while (lex_token(&lexer, &token))
+        token_buffer_push(chunk->tokens, &token);
+    return NULL;
+}
+
+// Copy a chunk into the stitched buffer. Offsets are already relative to
+// the whole input, only names have to be moved to the shared intern table.
+static void *stitch_chunk(void *arg)
+{
+    LexChunk *chunk = arg;
+    TokenBuffer *in = chunk->tokens;
+    TokenBuffer *out = chunk->out;
+    size_t base = chunk->out_index;
+    size_t count = in->count;
+
+    memcpy(out->types + base, in->types, count * sizeof(*in->types));
+    memcpy(out->offsets + base, in->offsets, count * sizeof(*in->offsets));
+    memcpy(out->lengths + base, in->lengths, count * sizeof(*in->lengths));
+    memcpy(out->suffixes + base, in->suffixes, count * sizeof(*in->suffixes));
+    for (size_t i = 0; i < count; i++)
+    {
+        if (in->types[i] == TOK_IDENT || in->types[i] == TOK_TYPE)
+            out->values[base + i].ident = intern_resolve(in->values[i].ident);
+        else
+            out->values[base + i] = in->values[i];
+    }
+    return NULL;
+}
+
+// Lex input on up to 'jobs' threads. Produces the same tokens as tokenize().
+TokenBuffer *tokenize_parallel(const char *input, size_t length, int jobs)
+{
+    int count = lex_chunk_count(length, jobs);
+    if (count == 1)
+        return tokenize(input, length);
+
+    const ScanKernels *scan = scan_kernels();
+    LexChunk *chunks = calloc(count, sizeof(LexChunk));
+    if (chunks == NULL)
+    {
+        perror("Failed to allocate memory.");
+        exit(1);
+    }
+
+    size_t start = 0;
+    for (int k = 0; k < count; k++)
+    {
+        chunks[k].input = input;
+        chunks[k].input_length = length;
+        chunks[k].start = start;
+        chunks[k].end = k == count - 1 ? length : find_split(scan, input, length, start, length / count * (k + 1));
+        start = chunks[k].end;
+    }
+    run_parallel(lex_chunk, chunks, sizeof(LexChunk), count);
+
+    size_t total = 0;
+    for (int k = 0; k < count; k++)
+    {
+        intern_merge(context_interns, &chunks[k].interns);
+        chunks[k].out_index = total;
+        total += chunks[k].tokens->count;
+    }
+
+    TokenBuffer *tokens = token_buffer_new(input, length, total);
+    tokens->count = total;
+    for (int k = 0; k < count; k++)
+        chunks[k].out = tokens;
+    run_parallel(stitch_chunk, chunks, sizeof(LexChunk), count);
+
+    for (int k = 0; k < count; k++)
+    {
+        arena_stats_merge(&context_arena->stats, &chunks[k].arena.stats);
+        arena_stats_merge(&context_interns->arena.stats, &chunks[k].interns.arena.stats);
+        arena_free(&chunks[k].arena);
+        intern_free(&chunks[k].interns);
+    }
+    free(chunks);
+    return tokens;
+}
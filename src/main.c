@@ -1,53 +1,230 @@
+#define _DEFAULT_SOURCE
 #include <mylang/arena.h>
 #include <mylang/asm.h>
 #include <mylang/ast.h>
+#include <mylang/ast_cache.h>
 #include <mylang/hashmap.h>
+#include <mylang/intern.h>
 #include <mylang/lex.h>
 #include <mylang/parse.h>
 #include <mylang/sema.h>
+#include <mylang/source.h>
 #include <mylang/util.h>
 #include <mylang/version.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <unistd.h>
 
 typedef struct CompilerOptions
 {
     char *file_name;
+    // Assembly file written for file_name
+    char *out_name;
     bool dump_ast;
     bool dump_tokens;
+    // Threads used to compile several files, or to lex and parse a large one
+    int jobs;
+    // Directory of AST cache files, NULL if not caching
+    char *ast_cache;
+    // Set by -o, the assembly file of the only input
+    char *output;
+    // Set by -output-dir, where the assembly of every input goes
+    char *output_dir;
+    char **inputs;
+    int input_count;
+    // Print the arena usage of every compiler phase
+    bool mem_report;
 } CompilerOptions;
 
-struct CompilerOptions opt;
+// Arena usage of the phases of one compile. Counters are per phase,
+// usage is the one at the end of the phase and the peak is the highest
+// usage reached by then.
+typedef struct MemReport
+{
+    struct
+    {
+        const char *name;
+        Arena_Stats stats;
+    } phases[8];
+    int count;
+    Arena_Stats last;
+    // Arena of data released before the end of the compile, counted
+    // separately until then
+    Arena *scratch;
+} MemReport;
+
+// Files of a batch, taken in order by the worker threads
+typedef struct BatchQueue
+{
+    CompilerOptions *jobs;
+    int count;
+    int next;
+    pthread_mutex_t lock;
+    // Warnings of a file are held back until it is compiled, so those of
+    // files compiled concurrently are not interleaved
+    bool buffered;
+} BatchQueue;
+
+// Usage of the arenas of the compile running on this thread. Hash maps
+// are malloc'd and cache files mapped, neither is counted.
+Arena_Stats memory_usage(MemReport *report)
+{
+    Arena_Stats stats = context_arena->stats;
+    arena_stats_add(&stats, &context_interns->arena.stats);
+    if (report->scratch)
+        arena_stats_add(&stats, &report->scratch->stats);
+    return stats;
+}
+
+void mem_report_begin(MemReport *report, Arena *scratch)
+{
+    report->count = 0;
+    report->scratch = scratch;
+    report->last = memory_usage(report);
+}
+
+// The scratch arena is about to be freed, its counters move to the
+// context arena
+void mem_report_release(MemReport *report)
+{
+    arena_stats_merge(&context_arena->stats, &report->scratch->stats);
+    report->scratch = NULL;
+}
+
+void mem_report_phase(MemReport *report, const char *name)
+{
+    Arena_Stats now = memory_usage(report);
+    Arena_Stats *phase = &report->phases[report->count].stats;
+    report->phases[report->count++].name = name;
+    phase->regions = now.regions - report->last.regions;
+    phase->skipped = now.skipped - report->last.skipped;
+    phase->oversized = now.oversized - report->last.oversized;
+    phase->requested = now.requested - report->last.requested;
+    phase->reserved = now.reserved - report->last.reserved;
+    phase->used = now.used;
+    if (now.peak < report->last.peak)
+        now.peak = report->last.peak;
+    phase->peak = now.peak;
+    report->last = now;
+}
+
+void mem_report_print(MemReport *report, const char *file_name)
+{
+    Arena_Stats total = {0};
+
+    // Reports of files compiled concurrently are not interleaved
+    flockfile(stderr);
+    fprintf(stderr, "my-lang: memory report for '%s' (KiB)\n", file_name);
+    fprintf(stderr, "%-10s %8s %8s %9s %12s %12s %12s %12s\n", "phase", "regions", "skipped", "oversized",
+            "requested", "reserved", "in use", "peak");
+    for (int i = 0; i < report->count; i++)
+    {
+        Arena_Stats *phase = &report->phases[i].stats;
+        fprintf(stderr, "%-10s %8zu %8zu %9zu %12zu %12zu %12zu %12zu\n", report->phases[i].name, phase->regions,
+                phase->skipped, phase->oversized, phase->requested / 1024, phase->reserved / 1024, phase->used / 1024,
+                phase->peak / 1024);
+        arena_stats_merge(&total, phase);
+    }
+    fprintf(stderr, "%-10s %8zu %8zu %9zu %12zu %12zu %12zu %12zu\n", "total", total.regions, total.skipped,
+            total.oversized, total.requested / 1024, total.reserved / 1024, report->last.used / 1024,
+            report->last.peak / 1024);
+    funlockfile(stderr);
+}
 
 void my_lang(CompilerOptions opt)
 {
-    size_t input_length = 0;
-    char *input = read_file(opt.file_name, &input_length);
+    // Holds the token buffer, which is dead once the AST is built
+    Arena *arena = context_arena;
+    Arena scratch = {0};
+    MemReport report;
+    mem_report_begin(&report, &scratch);
+
+    Source source;
+    if (!source_open(&source, opt.file_name))
+    {
+        fprintf(stderr, "my-lang: cannot read '%s'\n", opt.file_name);
+        exit(1);
+    }
+    const char *input = source.data;
+    size_t input_length = source.length;
 
     HashMap *type_env = hashmap_new();
     type_env_init(type_env);
 
-    Vector *tokens = tokenize(input, input_length);
+    // An unchanged source skips the frontend, tokens are never cached
+    TokenBuffer *tokens = NULL;
+    AstPool *prog = NULL;
+    SymbolVec *symbols;
+    uint64_t source_hash = 0;
+    char *cache = NULL;
+    if (opt.ast_cache && !opt.dump_tokens)
+    {
+        source_hash = hash_bytes(input, input_length);
+        cache = ast_cache_path(opt.ast_cache, source_hash);
+        prog = ast_cache_load(cache, source_hash, input_length, &symbols);
+    }
+
+    if (prog)
+    {
+        // Same warnings as the compile that wrote the cache
+        warn_unused(symbols);
+        mem_report_phase(&report, "cache");
+    }
+    else
+    {
+        // Tokens are only kept around when they have to be dumped or are lexed
+        // or parsed in parallel, otherwise the parser pulls them from the lexer
+        if (opt.dump_tokens || lex_chunk_count(input_length, opt.jobs) > 1 ||
+            parse_chunk_count(input_length / SOURCE_BYTES_PER_TOKEN, opt.jobs) > 1)
+        {
+            context_arena = &scratch;
+            tokens = tokenize_parallel(input, input_length, opt.jobs);
+            context_arena = arena;
+            mem_report_phase(&report, "lex");
+            prog = parse_parallel(tokens, opt.jobs);
+            if (!opt.dump_tokens)
+            {
+                mem_report_release(&report);
+                arena_free(&scratch);
+            }
+            mem_report_phase(&report, "parse");
+        }
+        else
+        {
+            prog = parse_source(input, input_length);
+            mem_report_phase(&report, "lex+parse");
+        }
 
-    Vector *prog = parse(tokens);
+        symbols = sema_check(prog, type_env);
+        mem_report_phase(&report, "sema");
 
-    sema_check(prog, type_env);
+        // Before codegen, which marks params as loaded into registers
+        if (cache)
+        {
+            if (!ast_cache_write(cache, prog, symbols, source_hash, input_length))
+                fprintf(stderr, "my-lang: cannot write AST cache '%s'\n", cache);
+            mem_report_phase(&report, "cache");
+        }
+    }
 
     if (opt.dump_tokens)
     {
         dump_tokens(tokens);
-        exit(0);
+        mem_report_release(&report);
+        arena_free(&scratch);
     }
-
-    if (opt.dump_ast)
-    {
+    else if (opt.dump_ast)
         dump_ast(prog);
-        exit(0);
-    }
-
-    gen_asm(prog);
+    else
+        gen_asm(prog, opt.out_name);
+    mem_report_phase(&report, opt.dump_tokens || opt.dump_ast ? "dump" : "codegen");
 
+    if (opt.mem_report)
+        mem_report_print(&report, opt.file_name);
+    ast_cache_close(prog);
     type_env_free(type_env);
+    source_close(&source);
 }
 
 void print_version()
@@ -59,17 +236,36 @@ void print_version()
 void print_help()
 {
 
-    char *message = "Usage: my-lang [options] file.c\n\n"
+    char *message = "Usage: my-lang [options] file.c...\n\n"
+                    "Reads the source from stdin when file.c is '-'\n"
+                    "Several files are compiled concurrently\n\n"
                     "Options:\n"
                     "\t-v, --version    Print version and exit\n"
                     "\t-h, --help       Show this help\n"
                     "\t-dump-tokens     Print Tokens\n"
-                    "\t-dump-ast        Print AST\n";
+                    "\t-dump-ast        Print AST\n"
+                    "\t-o FILE          Write the assembly of the only input to FILE (default: asm.s)\n"
+                    "\t-output-dir DIR  Write the assembly of every input to DIR/<name>.s\n"
+                    "\t-j N             Compile on N threads (default: number of CPUs)\n"
+                    "\t-ast-cache DIR   Reuse the checked AST of unchanged sources, cached in DIR\n"
+                    "\t-mem-report      Print the arena memory used by every compiler phase\n";
     printf("%s", message);
 }
 
-void parse_args(int argc, char **argv)
+// Value of the option at argv[i], which has to be followed by one
+char *option_value(int argc, char **argv, int i)
+{
+    if (i + 1 >= argc)
+    {
+        fprintf(stderr, "my-lang: missing argument to '%s'\n", argv[i]);
+        exit(1);
+    }
+    return argv[i + 1];
+}
+
+CompilerOptions parse_args(int argc, char **argv)
 {
+    CompilerOptions opt = {0};
 
     if (argc < 2)
     {
@@ -89,22 +285,162 @@ void parse_args(int argc, char **argv)
         exit(0);
     }
 
-    for (int i = 0; i < argc - 1; i++)
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    opt.jobs = cpus > 0 ? (int)cpus : 1;
+    opt.inputs = context_alloc(argc * sizeof(char *));
+
+    for (int i = 1; i < argc; i++)
     {
         if (!strcmp("-dump-tokens", argv[i]))
             opt.dump_tokens = true;
-        if (!strcmp("-dump-ast", argv[i]))
+        else if (!strcmp("-dump-ast", argv[i]))
             opt.dump_ast = true;
+        else if (!strcmp("-mem-report", argv[i]))
+            opt.mem_report = true;
+        else if (!strcmp("-j", argv[i]))
+        {
+            opt.jobs = atoi(option_value(argc, argv, i++));
+            if (opt.jobs < 1)
+            {
+                fprintf(stderr, "my-lang: invalid job count '%s'\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (!strcmp("-ast-cache", argv[i]))
+            opt.ast_cache = option_value(argc, argv, i++);
+        else if (!strcmp("-o", argv[i]))
+            opt.output = option_value(argc, argv, i++);
+        else if (!strcmp("-output-dir", argv[i]))
+            opt.output_dir = option_value(argc, argv, i++);
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            fprintf(stderr, "my-lang: unknown option '%s'\n", argv[i]);
+            exit(1);
+        }
+        else
+            opt.inputs[opt.input_count++] = argv[i];
     }
 
-    opt.file_name = argv[argc - 1];
+    if (opt.input_count == 0)
+    {
+        printf("Please provide an input file.\n");
+        exit(0);
+    }
+    if (opt.output && opt.input_count > 1)
+    {
+        fprintf(stderr, "my-lang: -o needs a single input file, use -output-dir for several\n");
+        exit(1);
+    }
+    return opt;
+}
+
+// Assembly file of an input. A single input keeps writing asm.s, inputs
+// of a batch are named after their source, "-" after stdin.
+char *output_name(const CompilerOptions *opt, const char *file_name)
+{
+    if (opt->output)
+        return opt->output;
+    if (opt->input_count == 1 && opt->output_dir == NULL)
+        return "./asm.s";
+
+    const char *base = strrchr(file_name, '/');
+    base = base ? base + 1 : file_name;
+    if (!strcmp(base, "-"))
+        base = "stdin";
+    const char *ext = strrchr(base, '.');
+    int length = ext && ext != base ? (int)(ext - base) : (int)strlen(base);
+    return arena_sprintf(context_arena, "%s/%.*s.s", opt->output_dir ? opt->output_dir : ".", length, base);
+}
+
+void *batch_worker(void *arg)
+{
+    BatchQueue *queue = *(BatchQueue **)arg;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->lock);
+        int i = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (i >= queue->count)
+            break;
+
+        // Every file is compiled in a context of its own
+        Arena job_arena = {0};
+        InternTable job_interns = {0};
+        char *messages = NULL;
+        size_t length = 0;
+        FILE *diagnostics = queue->buffered ? open_memstream(&messages, &length) : NULL;
+        Context saved = context_swap((Context){&job_arena, &job_interns, diagnostics});
+        my_lang(queue->jobs[i]);
+        context_swap(saved);
+
+        if (diagnostics)
+        {
+            fclose(diagnostics);
+            fwrite(messages, 1, length, stdout);
+            free(messages);
+        }
+        arena_free(&job_arena);
+        intern_free(&job_interns);
+    }
+    return NULL;
+}
+
+// Compile every input on a pool of opt->jobs threads. Dumps are printed
+// by a single thread, so they come out in the order of the inputs.
+void compile_batch(const CompilerOptions *opt)
+{
+    BatchQueue queue = {0};
+    HashMap *outputs = hashmap_new();
+
+    queue.count = opt->input_count;
+    queue.jobs = context_alloc(queue.count * sizeof(CompilerOptions));
+    pthread_mutex_init(&queue.lock, NULL);
+
+    int workers = opt->dump_ast || opt->dump_tokens ? 1 : opt->jobs;
+    if (workers > queue.count)
+        workers = queue.count;
+    queue.buffered = workers > 1;
+
+    for (int i = 0; i < queue.count; i++)
+    {
+        CompilerOptions *job = &queue.jobs[i];
+        *job = *opt;
+        job->file_name = opt->inputs[i];
+        job->out_name = output_name(opt, job->file_name);
+        // Threads left over once every worker has a file
+        job->jobs = opt->jobs / workers > 1 ? opt->jobs / workers : 1;
+
+        char *other = hashmap_get(outputs, job->out_name);
+        if (other && !opt->dump_ast && !opt->dump_tokens)
+        {
+            fprintf(stderr, "my-lang: '%s' and '%s' would both be written to '%s'\n", other, job->file_name,
+                    job->out_name);
+            exit(1);
+        }
+        hashmap_add(outputs, job->file_name, job->out_name);
+    }
+    hashmap_free(outputs);
+
+    BatchQueue **items = context_alloc(workers * sizeof(BatchQueue *));
+    for (int k = 0; k < workers; k++)
+        items[k] = &queue;
+    run_parallel(batch_worker, items, sizeof(BatchQueue *), workers);
+    pthread_mutex_destroy(&queue.lock);
 }
 
 int main(int argc, char **argv)
 {
-    parse_args(argc, argv);
+    CompilerOptions opt = parse_args(argc, argv);
 
-    my_lang(opt);
+    if (opt.input_count == 1)
+    {
+        opt.file_name = opt.inputs[0];
+        opt.out_name = output_name(&opt, opt.file_name);
+        my_lang(opt);
+    }
+    else
+        compile_batch(&opt);
 
     arena_free(context_arena);
 
@@ -1,4 +1,5 @@
 #include <mylang/ast.h>
+#include <mylang/intern.h>
 #include <mylang/lex.h>
 #include <mylang/parse.h>
 #include <mylang/util.h>
@@ -6,56 +7,128 @@
 #include <stdlib.h>
 #include <time.h>
 
-// Get current token in stream
-// Returns NULL if end of stream
-Token *current_token(TokenStream *stream)
+// Pull tokens from the lexer until token i is buffered.
+// Returns false at end of input.
+static bool fill(TokenStream *stream, size_t i)
 {
-    if (stream->current >= stream->tokens->length)
+    Token token;
+    while (stream->end <= i)
     {
-        return NULL;
+        if (stream->lexer == NULL || !lex_token(stream->lexer, &token))
+            return false;
+        token_buffer_set(stream->tokens, stream->end & stream->mask, &token);
+        stream->end++;
     }
-    return (Token *)vector_get(stream->tokens, stream->current);
+    return true;
+}
+
+// Type of the nth token after current
+// Returns TOK_EOF if outside of stream size
+TokenType peek_type(TokenStream *stream, int n)
+{
+    size_t i = stream->current + n;
+    assert(stream->lexer == NULL || n < TOKEN_LOOKAHEAD);
+    if (i >= stream->end && !fill(stream, i))
+        return TOK_EOF;
+    return (TokenType)stream->tokens->types[i & stream->mask];
+}
+
+TokenType current_type(TokenStream *stream)
+{
+    return peek_type(stream, 0);
 }
 
 // Get next nth token in stream
 // Returns NULL if outside of stream size
 Token *peek(TokenStream *stream, int n)
 {
-    if (n + stream->current >= stream->tokens->length)
-    {
+    size_t i = stream->current + n;
+    assert(stream->lexer == NULL || n < TOKEN_LOOKAHEAD);
+    if (i >= stream->end && !fill(stream, i))
         return NULL;
-    }
-    return (Token *)vector_get(stream->tokens, n + stream->current);
+
+    Token *view = &stream->view[i & (TOKEN_RING_SIZE - 1)];
+    *view = token_at(stream->tokens, i & stream->mask);
+    return view;
+}
+
+// Get current token in stream
+// Returns NULL if end of stream
+Token *current_token(TokenStream *stream)
+{
+    return peek(stream, 0);
 }
 
 // Set next token in stream
 void next_token(TokenStream *stream)
 {
-    if (stream->current >= stream->tokens->length)
-    {
-        return;
-    }
-    (stream->current)++;
+    if (stream->current < stream->end || fill(stream, stream->current))
+        stream->current++;
 }
 
-TokenStream *make_token_stream(Vector *tokens)
+// Stream over the whole token list, adding nodes to ast
+void token_stream_init(TokenStream *stream, TokenBuffer *tokens, AstPool *ast)
 {
-    TokenStream *stream = (TokenStream *)context_alloc(sizeof(TokenStream));
-
+    stream->input = tokens->input;
     stream->tokens = tokens;
     stream->current = 0;
+    stream->end = tokens->count;
+    stream->mask = SIZE_MAX;
+    stream->lexer = NULL;
+    stream->ast = ast;
+}
+
+TokenStream *make_token_stream(TokenBuffer *tokens)
+{
+    TokenStream *stream = (TokenStream *)context_alloc(sizeof(TokenStream));
+    token_stream_init(stream, tokens, ast_pool_new(context_arena));
     return stream;
 }
 
+// Stream that lexes tokens on demand instead of
+// holding the whole token list in memory
+TokenStream *make_lexer_stream(Lexer *lexer)
+{
+    TokenStream *stream = make_token_stream(token_buffer_new(lexer->input, lexer->length, TOKEN_RING_SIZE));
+    stream->mask = TOKEN_RING_SIZE - 1;
+    stream->lexer = lexer;
+    return stream;
+}
+
+// Copy the source text of token into a C string
+char *token_text(TokenStream *stream, Token *token)
+{
+    return token_str(stream->input, token);
+}
+
+// Interned name of an identifier or type token. Tokens that
+// did not come from the lexer are interned here.
+char *token_name(TokenStream *stream, Token *token)
+{
+    if (token->ident == NULL)
+        token->ident = intern(context_interns, stream->input + token->offset, token->length);
+    return token->ident;
+}
+
+// Line and column of token, only looked up for diagnostics
+SourcePos token_pos(TokenStream *stream, Token *token)
+{
+    return source_pos(stream->input, stream->tokens->input_length, token->offset);
+}
+
 // Returns current token in stream
 // if TokenType matches 'expect'
-// errors otherwise
+// errors otherwise, also at the end of input
 Token *expect(TokenStream *stream, TokenType expect)
 {
     Token *current = current_token(stream);
     if (current == NULL)
     {
-        return current;
+        size_t length = stream->tokens->input_length;
+        SourcePos pos = source_pos(stream->input, length, length);
+        fprintf(stderr, "Unexpected end of input at line: %d, column: %d, expected token of type %d\n", pos.line,
+                pos.column, expect);
+        exit(1);
     }
     if (current->type == expect)
     {
@@ -63,41 +136,53 @@ Token *expect(TokenStream *stream, TokenType expect)
         return current;
     }
 
-    fprintf(stderr, "Expected token of type %d at line: %d, pos: %d, actual type: %d\n", expect, current->line,
-            current->pos, current->type);
+    SourcePos pos = token_pos(stream, current);
+    fprintf(stderr, "Expected token of type %d at line: %d, column: %d, actual type: %d\n", expect, pos.line,
+            pos.column, current->type);
     exit(1);
 }
 
-AstNode *parse_ident(TokenStream *stream)
+// Add the interned name of token to the pool
+static AstName parse_name(TokenStream *stream, Token *token)
+{
+    return ast_add_name(stream->ast, token_name(stream, token));
+}
+
+AstRef parse_ident(TokenStream *stream)
 {
-    Token *current = current_token(stream);
-    char *value = as_str(current->value);
     if (is_func_call_start(stream))
     {
         return parse_func_call(stream);
     }
+    AstName name = parse_name(stream, current_token(stream));
     next_token(stream);
-    return make_ast_ident(value);
+    return make_ast_ident(stream->ast, name);
 }
 
-AstNode *parse_primary_expression(TokenStream *stream)
+AstRef parse_primary_expression(TokenStream *stream)
 {
-
-    Token *current = current_token(stream);
-    if (current != NULL && current->type == TOK_NUM)
+    TokenType type = current_type(stream);
+    if (type == TOK_NUM)
     {
-        int lit;
+        Token *current = current_token(stream);
+        // int, long and unsigned are all 32 bits wide on the target
+        if (current->value > UINT32_MAX)
+        {
+            SourcePos pos = token_pos(stream, current);
+            fprintf(stderr, "Integer constant does not fit in 32 bits at line: %d, column: %d\n", pos.line,
+                    pos.column);
+            exit(1);
+        }
+        int lit = (int)(uint32_t)current->value;
         next_token(stream);
-        char *int_str = as_str(current->value);
-        str2int(&lit, int_str, 10);
-        return make_int_const(lit);
+        return make_int_const(stream->ast, lit);
     }
-    else if (current != NULL && current->type == TOK_IDENT)
+    else if (type == TOK_IDENT)
         return parse_ident(stream);
-    else if (current != NULL && current->type == TOK_LPAREN)
+    else if (type == TOK_LPAREN)
     {
         next_token(stream);
-        AstNode *ret = parse_expression(stream);
+        AstRef ret = parse_expression(stream);
 
         expect(stream, TOK_RPAREN);
 
@@ -105,11 +190,11 @@ AstNode *parse_primary_expression(TokenStream *stream)
     }
     else
     {
-        return make_ast_node(AST_EMPTY_EXPR, NULL);
+        return make_ast_empty_expr(stream->ast);
     }
 }
 
-AstNode *parse_postfix_expression(TokenStream *stream)
+AstRef parse_postfix_expression(TokenStream *stream)
 {
     return parse_primary_expression(stream);
 }
@@ -119,225 +204,83 @@ bool is_unary_op(TokenType op_type)
     return op_type == TOK_NOT;
 }
 
-AstNode *parse_unary_expression(TokenStream *stream)
+AstRef parse_unary_expression(TokenStream *stream)
 {
 
-    char *value;
-    TokenType op_type;
-    Token *current = current_token(stream);
+    TokenType op_type = current_type(stream);
 
-    if (is_unary_op(current->type))
+    if (is_unary_op(op_type))
     {
-        value = as_str(current->value);
-        op_type = current->type;
         next_token(stream);
-        return make_ast_unary_expr(parse_postfix_expression(stream), value, op_type);
+        return make_ast_unary_expr(stream->ast, parse_postfix_expression(stream), op_type);
     }
 
     return parse_postfix_expression(stream);
 }
 
-AstNode *parse_cast_expression(TokenStream *stream)
+AstRef parse_cast_expression(TokenStream *stream)
 {
     return parse_unary_expression(stream);
 }
 
-AstNode *parse_multiplicative_expression(TokenStream *stream)
-{
-    AstNode *left = parse_cast_expression(stream);
-    Token *current;
-
-    while ((current = current_token(stream)) && (current->type == TOK_MULT || current->type == TOK_DIV))
-    {
-        char *value = as_str(current->value);
-        TokenType op_type = current->type;
-        next_token(stream);
-        AstNode *right = parse_cast_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
-    }
-    return left;
-}
-
-AstNode *parse_additive_expression(TokenStream *stream)
-{
-    AstNode *left = parse_multiplicative_expression(stream);
-    Token *current;
-
-    while ((current = current_token(stream)) && (current->type == TOK_ADD || current->type == TOK_SUB))
-    {
-        char *value = as_str(current->value);
-        TokenType op_type = current->type;
-        next_token(stream);
-        AstNode *right = parse_multiplicative_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
-    }
-    return left;
-}
-
-AstNode *parse_shift_expression(TokenStream *stream)
-{
-    AstNode *left = parse_additive_expression(stream);
-    Token *current;
-
-    while ((current = current_token(stream)) && (current->type == TOK_LSHIFT || current->type == TOK_RSHIFT))
-    {
-        char *value = as_str(current->value);
-        TokenType op_type = current->type;
-        next_token(stream);
-        AstNode *right = parse_additive_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
-    }
-    return left;
-}
-
-bool is_relational_op(TokenType type)
-{
-    return type == TOK_GT || type == TOK_LT || type == TOK_GT_EQ || type == TOK_LT_EQ;
-}
-
-AstNode *parse_relational_expression(TokenStream *stream)
-{
-    AstNode *left = parse_shift_expression(stream);
-    Token *current;
-
-    while ((current = current_token(stream)) && is_relational_op(current->type))
-    {
-        char *value = as_str(current->value);
-        TokenType op_type = current->type;
-
-        next_token(stream);
-        AstNode *right = parse_shift_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
-    }
-    return left;
-}
-
-AstNode *parse_equality_expression(TokenStream *stream)
-{
-    AstNode *left = parse_relational_expression(stream);
-    Token *current;
-
-    while ((current = current_token(stream)) && (current->type == TOK_NOT_EQUAL || current->type == TOK_EQUAL))
-    {
-        char *value = as_str(current->value);
-        TokenType op_type = current->type;
-
-        next_token(stream);
-        AstNode *right = parse_relational_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
-    }
-    return left;
-}
-
-AstNode *parse_and_expression(TokenStream *stream)
-{
-    AstNode *left = parse_equality_expression(stream);
-    Token *current;
-
-    while ((current = current_token(stream)) && current->type == TOK_AND)
-    {
-        char *value = as_str(current->value);
-        TokenType op_type = current->type;
-
-        next_token(stream);
-        AstNode *right = parse_equality_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
-    }
-    return left;
-}
-
-AstNode *parse_xor_expression(TokenStream *stream)
-{
-    AstNode *left = parse_and_expression(stream);
-    Token *current;
-
-    while ((current = current_token(stream)) && current->type == TOK_XOR)
-    {
-        char *value = as_str(current->value);
-        TokenType op_type = current->type;
-
-        next_token(stream);
-        AstNode *right = parse_and_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
-    }
-    return left;
-}
-
-AstNode *parse_or_expression(TokenStream *stream)
-{
-    AstNode *left = parse_xor_expression(stream);
-    Token *current;
-
-    while ((current = current_token(stream)) && current->type == TOK_OR)
-    {
-        char *value = as_str(current->value);
-        TokenType op_type = current->type;
-
-        next_token(stream);
-        AstNode *right = parse_xor_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
-    }
-    return left;
-}
-
-AstNode *parse_log_and_expression(TokenStream *stream)
-{
-    AstNode *left = parse_or_expression(stream);
-    Token *current;
-
-    while ((current = current_token(stream)) && (current->type == TOK_LOG_AND))
-    {
-        char *value = as_str(current->value);
-
-        TokenType op_type = current->type;
-        next_token(stream);
-        AstNode *right = parse_or_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
-    }
-    return left;
-}
-
-AstNode *parse_log_or_expression(TokenStream *stream)
-{
-    AstNode *left = parse_log_and_expression(stream);
-    Token *current;
+// How tightly each binary operator binds, 0 for tokens that are not one.
+// All binary operators are left associative.
+static const unsigned char binding_power[TOK_EOF + 1] = {
+    [TOK_LOG_OR] = 1,
+    [TOK_LOG_AND] = 2,
+    [TOK_OR] = 3,
+    [TOK_XOR] = 4,
+    [TOK_AND] = 5,
+    [TOK_EQUAL] = 6,
+    [TOK_NOT_EQUAL] = 6,
+    [TOK_GT] = 7,
+    [TOK_LT] = 7,
+    [TOK_GT_EQ] = 7,
+    [TOK_LT_EQ] = 7,
+    [TOK_LSHIFT] = 8,
+    [TOK_RSHIFT] = 8,
+    [TOK_ADD] = 9,
+    [TOK_SUB] = 9,
+    [TOK_MULT] = 10,
+    [TOK_DIV] = 10,
+};
+
+// Precedence climbing: parse operands and every operator binding
+// tighter than min_power in one loop instead of a function per level
+AstRef parse_binary_expression(TokenStream *stream, int min_power)
+{
+    AstRef left = parse_cast_expression(stream);
+    TokenType op_type;
+    int power;
 
-    while ((current = current_token(stream)) && (current->type == TOK_LOG_OR))
+    while ((power = binding_power[op_type = current_type(stream)]) > min_power)
     {
-        char *value = as_str(current->value);
-
-        TokenType op_type = current->type;
         next_token(stream);
-        AstNode *right = parse_log_and_expression(stream);
-        left = make_ast_bin_exp(value, op_type, left, right);
+        AstRef right = parse_binary_expression(stream, power);
+        left = make_ast_bin_exp(stream->ast, op_type, left, right);
     }
     return left;
 }
 
-AstNode *parse_conditional_expression(TokenStream *stream)
+AstRef parse_conditional_expression(TokenStream *stream)
 {
-    return parse_log_or_expression(stream);
+    return parse_binary_expression(stream, 0);
 }
 
-AstNode *parse_var_asgn(TokenStream *stream)
+AstRef parse_var_asgn(TokenStream *stream)
 {
 
-    AstLValue *lval_node;
-
-    AstNode *ident_node = parse_ident(stream);
-    AstNode *base_lval_node = make_ast_lval(AST_LVAL_IDENT);
-
-    lval_node = (AstLValue *)base_lval_node->as;
-    lval_node->u.ident = ident_node;
+    AstRef ident_node = parse_ident(stream);
+    AstRef lval_node = make_ast_lval(stream->ast, AST_LVAL_IDENT, ident_node);
 
     expect(stream, TOK_ASSIGN);
 
-    AstNode *rval = parse_expression(stream);
+    AstRef rval = parse_expression(stream);
 
-    return make_ast_var_asgn(base_lval_node, rval);
+    return make_ast_var_asgn(stream->ast, lval_node, rval);
 }
 
-AstNode *parse_expression(TokenStream *stream)
+AstRef parse_expression(TokenStream *stream)
 {
     if (is_var_asgn(stream))
         return parse_var_asgn(stream);
@@ -347,26 +290,25 @@ AstNode *parse_expression(TokenStream *stream)
 
 int is_func_call_start(TokenStream *stream)
 {
-    Token *func_name = current_token(stream);
-    Token *lparen = peek(stream, 1);
-    return func_name->type == TOK_IDENT && lparen->type == TOK_LPAREN;
+    return current_type(stream) == TOK_IDENT && peek_type(stream, 1) == TOK_LPAREN;
 }
 
-AstNode *parse_func_call(TokenStream *stream)
+AstRef parse_func_call(TokenStream *stream)
 {
     Token *name = expect(stream, TOK_IDENT);
-    char *name_str = as_str(name->value);
+    AstName name_str = parse_name(stream, name);
     expect(stream, TOK_LPAREN);
 
-    Vector *args = vector_new();
-    while (current_token(stream)->type != TOK_RPAREN)
+    size_t args = ast_list_begin(stream->ast);
+    TokenType type;
+    while ((type = current_type(stream)) != TOK_EOF && type != TOK_RPAREN)
     {
 
-        AstNode *expr = parse_expression(stream);
+        AstRef expr = parse_expression(stream);
 
-        vector_push(args, expr);
+        ast_list_push(stream->ast, expr);
 
-        if (current_token(stream)->type == TOK_RPAREN)
+        if (current_type(stream) == TOK_RPAREN)
         {
             break;
         }
@@ -375,78 +317,68 @@ AstNode *parse_func_call(TokenStream *stream)
     }
     expect(stream, TOK_RPAREN);
 
-    return make_ast_func_call(name_str, args);
+    return make_ast_func_call(stream->ast, name_str, ast_list_end(stream->ast, args));
 }
 
 int is_func_def_start(TokenStream *stream)
 {
-    Token *func_type = current_token(stream);
-    Token *func_name = peek(stream, 1);
-    Token *paren = peek(stream, 2);
-    return func_type->type == TOK_TYPE && func_name->type == TOK_IDENT && paren->type == TOK_LPAREN;
+    return current_type(stream) == TOK_TYPE && peek_type(stream, 1) == TOK_IDENT && peek_type(stream, 2) == TOK_LPAREN;
 }
 
 bool is_var_def_start(TokenStream *stream)
 {
-    Token *var_type = current_token(stream);
-    Token *var_name = peek(stream, 1);
-    Token *assign = peek(stream, 2);
-    return var_type->type == TOK_TYPE && var_name->type == TOK_IDENT && assign->type == TOK_ASSIGN;
+    return current_type(stream) == TOK_TYPE && peek_type(stream, 1) == TOK_IDENT && peek_type(stream, 2) == TOK_ASSIGN;
 }
 
 bool is_var_dec(TokenStream *stream)
 {
-    Token *var_type = current_token(stream);
-    Token *var_name = peek(stream, 1);
-    Token *semi = peek(stream, 2);
-    return var_type->type == TOK_TYPE && var_name->type == TOK_IDENT && semi->type == TOK_SEMICOLON;
+    return current_type(stream) == TOK_TYPE && peek_type(stream, 1) == TOK_IDENT &&
+           peek_type(stream, 2) == TOK_SEMICOLON;
 }
 
 bool is_var_asgn(TokenStream *stream)
 {
-    Token *var_name = current_token(stream);
-    Token *asgn = peek(stream, 1);
-    return var_name->type == TOK_IDENT && asgn->type == TOK_ASSIGN;
+    return current_type(stream) == TOK_IDENT && peek_type(stream, 1) == TOK_ASSIGN;
 }
 
-AstNode *parse_if_else_statement(TokenStream *stream)
+AstRef parse_if_else_statement(TokenStream *stream)
 {
-    Token *current;
-    AstNode *else_body = NULL;
+    AstRef else_body = AST_NONE;
     expect(stream, TOK_IF);
     expect(stream, TOK_LPAREN);
-    AstNode *expr = parse_expression(stream);
+    AstRef expr = parse_expression(stream);
 
     expect(stream, TOK_RPAREN);
 
-    AstNode *if_body = parse_statement(stream);
-    if ((current = current_token(stream)) && current->type == TOK_ELSE)
+    AstRef if_body = parse_statement(stream);
+    if (current_type(stream) == TOK_ELSE)
     {
         expect(stream, TOK_ELSE);
         else_body = parse_statement(stream);
     }
 
-    return make_ast_if_else(expr, if_body, else_body);
+    return make_ast_if_else(stream->ast, expr, if_body, else_body);
 }
 
-AstNode *parse_enum(TokenStream *stream)
+AstRef parse_enum(TokenStream *stream)
 {
-    Token *curr;
+    TokenType type;
     Token *enum_ident;
     Token *parent_enum;
-    Vector *enums = vector_new();
+    size_t enums = ast_list_begin(stream->ast);
 
     expect(stream, TOK_ENUM);
     parent_enum = expect(stream, TOK_IDENT);
+    AstName parent_name = parse_name(stream, parent_enum);
     expect(stream, TOK_LBRACE);
 
-    while ((curr = current_token(stream)) && curr->type != TOK_RBRACE)
+    while ((type = current_type(stream)) != TOK_EOF && type != TOK_RBRACE)
     {
         enum_ident = expect(stream, TOK_IDENT);
 
-        vector_push(enums, as_str(enum_ident->value));
+        ast_list_push(stream->ast, parse_name(stream, enum_ident));
 
-        if ((curr = current_token(stream)) && curr->type != TOK_COMMA)
+        if ((type = current_type(stream)) != TOK_EOF && type != TOK_COMMA)
         {
             break;
         }
@@ -456,30 +388,30 @@ AstNode *parse_enum(TokenStream *stream)
     expect(stream, TOK_RBRACE);
     expect(stream, TOK_SEMICOLON);
 
-    return make_ast_enum(as_str(parent_enum->value), enums);
+    return make_ast_enum(stream->ast, parent_name, ast_list_end(stream->ast, enums));
 }
 
-AstNode *parse_comp_stmt(TokenStream *stream)
+AstRef parse_comp_stmt(TokenStream *stream)
 {
 
-    Token *current;
-    AstNode *stmt;
-    Vector *body = vector_new();
+    TokenType type;
+    AstRef stmt;
+    size_t body = ast_list_begin(stream->ast);
 
     expect(stream, TOK_LBRACE);
-    while ((current = current_token(stream)) && current_token(stream)->type != TOK_RBRACE)
+    while ((type = current_type(stream)) != TOK_EOF && type != TOK_RBRACE)
     {
         stmt = parse_statement(stream);
-        vector_push(body, stmt);
+        ast_list_push(stream->ast, stmt);
     }
     expect(stream, TOK_RBRACE);
-    return make_ast_comp_stmt(body);
+    return make_ast_comp_stmt(stream->ast, ast_list_end(stream->ast, body));
 }
 
-AstNode *parse_while(TokenStream *stream)
+AstRef parse_while(TokenStream *stream)
 {
-    AstNode *expr;
-    AstNode *body;
+    AstRef expr;
+    AstRef body;
 
     expect(stream, TOK_WHILE);
     expect(stream, TOK_LPAREN);
@@ -490,12 +422,12 @@ AstNode *parse_while(TokenStream *stream)
 
     body = parse_statement(stream);
 
-    return make_ast_while(expr, body);
+    return make_ast_while(stream->ast, expr, body);
 }
 
-AstNode *parse_for(TokenStream *stream)
+AstRef parse_for(TokenStream *stream)
 {
-    AstNode *init;
+    AstRef init;
     expect(stream, TOK_FOR);
     expect(stream, TOK_LPAREN);
     if (is_declartion(stream))
@@ -509,49 +441,48 @@ AstNode *parse_for(TokenStream *stream)
         expect(stream, TOK_SEMICOLON);
     }
 
-    AstNode *cond = parse_expression(stream);
+    AstRef cond = parse_expression(stream);
     expect(stream, TOK_SEMICOLON);
 
-    AstNode *step = parse_expression(stream);
+    AstRef step = parse_expression(stream);
     expect(stream, TOK_RPAREN);
 
-    AstNode *body = parse_statement(stream);
-    return make_ast_for(init, cond, step, body);
+    AstRef body = parse_statement(stream);
+    return make_ast_for(stream->ast, init, cond, step, body);
 }
 
-AstNode *parse_expression_statement(TokenStream *stream)
+AstRef parse_expression_statement(TokenStream *stream)
 {
 
-    AstNode *expr = parse_expression(stream);
+    AstRef expr = parse_expression(stream);
     expect(stream, TOK_SEMICOLON);
-    return make_expr_stmt(expr);
+    return make_expr_stmt(stream->ast, expr);
 }
 
-AstNode *parse_iter_statement(TokenStream *stream)
+AstRef parse_iter_statement(TokenStream *stream)
 {
-    Token *current = current_token(stream);
-    if (current->type == TOK_FOR)
+    if (current_type(stream) == TOK_FOR)
         return parse_for(stream);
 
     return parse_while(stream);
 }
 
-AstNode *parse_return(TokenStream *stream)
+AstRef parse_return(TokenStream *stream)
 {
     expect(stream, TOK_RETURN);
-    AstNode *expr = parse_expression(stream);
+    AstRef expr = parse_expression(stream);
 
-    AstNode *ret_node = make_ast_ret(expr);
+    AstRef ret_node = make_ast_ret(stream->ast, expr);
     expect(stream, TOK_SEMICOLON);
     return ret_node;
 }
 
-AstNode *parse_jump_statement(TokenStream *stream)
+AstRef parse_jump_statement(TokenStream *stream)
 {
     return parse_return(stream);
 }
 
-AstNode *parse_selection_statement(TokenStream *stream)
+AstRef parse_selection_statement(TokenStream *stream)
 {
     return parse_if_else_statement(stream);
 }
@@ -561,7 +492,7 @@ bool is_declartion(TokenStream *stream)
     return is_var_dec(stream) || is_var_def_start(stream);
 }
 
-AstNode *parse_declartion(TokenStream *stream)
+AstRef parse_declartion(TokenStream *stream)
 {
     if (is_var_def_start(stream))
         return parse_var_def(stream);
@@ -569,120 +500,127 @@ AstNode *parse_declartion(TokenStream *stream)
         return parse_var_dec(stream);
 }
 
-AstNode *parse_statement(TokenStream *stream)
+AstRef parse_statement(TokenStream *stream)
 {
-    Token *current = current_token(stream);
+    TokenType type = current_type(stream);
 
-    if (current->type == TOK_WHILE || current->type == TOK_FOR)
+    if (type == TOK_WHILE || type == TOK_FOR)
         return parse_iter_statement(stream);
     else if (is_declartion(stream))
         return parse_declartion(stream);
-    else if (current->type == TOK_RETURN)
+    else if (type == TOK_RETURN)
         return parse_jump_statement(stream);
-    else if (current->type == TOK_IF)
+    else if (type == TOK_IF)
         return parse_selection_statement(stream);
-    else if (current->type == TOK_ENUM)
+    else if (type == TOK_ENUM)
         return parse_enum(stream);
-    else if (current->type == TOK_LBRACE)
+    else if (type == TOK_LBRACE)
         return parse_comp_stmt(stream);
     else
         return parse_expression_statement(stream);
 }
 
-Vector *parse_func_params(TokenStream *stream)
+AstList parse_func_params(TokenStream *stream)
 {
-    Vector *params = vector_new();
-    Token *current;
-    while ((current = current_token(stream)) && current_token(stream)->type == TOK_TYPE)
+    size_t params = ast_list_begin(stream->ast);
+    while (current_type(stream) == TOK_TYPE)
     {
         Token *param_type = expect(stream, TOK_TYPE);
         Token *param_name = expect(stream, TOK_IDENT);
 
-        char *ts_str = as_str(param_type->value);
+        AstName ts_str = parse_name(stream, param_type);
+        AstName name_str = parse_name(stream, param_name);
 
-        Param *param = (Param *)context_alloc(sizeof(Param));
-        param->type = ts_str;
-        param->value = as_str(param_name->value);
-        vector_push(params, param);
+        ast_list_push(stream->ast, make_ast_param(stream->ast, name_str, ts_str));
 
-        if (current_token(stream)->type == TOK_RPAREN)
+        if (current_type(stream) == TOK_RPAREN)
         {
             break;
         }
         expect(stream, TOK_COMMA);
     }
 
-    return params;
+    return ast_list_end(stream->ast, params);
 }
 
-AstNode *parse_func_def(TokenStream *stream)
+AstRef parse_func_def(TokenStream *stream)
 {
     Token *func_type = expect(stream, TOK_TYPE);
     Token *func_name = expect(stream, TOK_IDENT);
 
-    char *func_str = as_str(func_name->value);
+    AstName func_str = parse_name(stream, func_name);
+    AstName ts_name = parse_name(stream, func_type);
 
     // Parse function args
     expect(stream, TOK_LPAREN);
-    Vector *params = parse_func_params(stream);
+    AstList params = parse_func_params(stream);
     expect(stream, TOK_RPAREN);
 
-    char *ts_name = as_str(func_type->value);
-
     // Parse function body
-    AstNode *body = parse_comp_stmt(stream);
-    return make_ast_func_def(func_str, ts_name, body, params);
+    AstRef body = parse_comp_stmt(stream);
+    return make_ast_func_def(stream->ast, func_str, ts_name, body, params);
 }
 
-AstNode *parse_var_dec(TokenStream *stream)
+AstRef parse_var_dec(TokenStream *stream)
 {
     Token *dec_type = expect(stream, TOK_TYPE);
     Token *dec_value = expect(stream, TOK_IDENT);
 
-    char *value = as_str(dec_value->value);
-    char *type = as_str(dec_type->value);
+    AstName value = parse_name(stream, dec_value);
+    AstName type = parse_name(stream, dec_type);
 
     expect(stream, TOK_SEMICOLON);
-    return make_ast_var_dec(value, type);
+    return make_ast_var_dec(stream->ast, value, type);
 }
 
-AstNode *parse_var_def(TokenStream *stream)
+AstRef parse_var_def(TokenStream *stream)
 {
     Token *var_type = expect(stream, TOK_TYPE);
     Token *var_name = expect(stream, TOK_IDENT);
-    char *var_str = as_str(var_name->value);
-    char *type_str = as_str(var_type->value);
+    AstName var_str = parse_name(stream, var_name);
+    AstName type_str = parse_name(stream, var_type);
 
     // Parse init expression
-    AstNode *init = NULL;
-    if (current_token(stream)->type == TOK_ASSIGN)
+    AstRef init = AST_NONE;
+    if (current_type(stream) == TOK_ASSIGN)
     {
         next_token(stream);
         init = parse_expression(stream);
     }
     expect(stream, TOK_SEMICOLON);
 
-    return make_ast_var_def(var_str, type_str, init);
+    return make_ast_var_def(stream->ast, var_str, type_str, init);
 }
 
-Vector *parse_prog(TokenStream *stream)
+AstPool *parse_prog(TokenStream *stream)
 {
-    Token *curr;
-    AstNode *stmt;
-    Vector *prog = vector_new();
-    while ((curr = current_token(stream)))
+    AstRef stmt;
+    size_t prog = ast_list_begin(stream->ast);
+    while (current_type(stream) != TOK_EOF)
     {
 
         stmt = parse_func_def(stream);
-        vector_push(prog, stmt);
+        ast_list_push(stream->ast, stmt);
     }
-    return prog;
+    stream->ast->funcs = ast_list_end(stream->ast, prog);
+    return stream->ast;
 }
 
-// Returns list of AstNode representing program
-Vector *parse(Vector *tokens)
+// Returns the AST of the program
+AstPool *parse(TokenBuffer *tokens)
 {
     TokenStream *stream = make_token_stream(tokens);
-    Vector *prog = parse_prog(stream);
-    return prog;
+    ast_pool_reserve(stream->ast, tokens->count);
+    return parse_prog(stream);
+}
+
+// Parse program straight from source, lexing
+// tokens only as the parser asks for them
+AstPool *parse_source(const char *input, size_t length)
+{
+    Lexer lexer;
+    lexer_init(&lexer, input, length);
+    TokenStream *stream = make_lexer_stream(&lexer);
+    ast_pool_reserve(stream->ast, length / SOURCE_BYTES_PER_TOKEN);
+    return parse_prog(stream);
 }
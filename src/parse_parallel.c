@@ -0,0 +1,167 @@
+#include <mylang/ast.h>
+#include <mylang/intern.h>
+#include <mylang/parse.h>
+#include <mylang/util.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Whole function definitions, tokens [start, end), parsed by one thread
+typedef struct ParseChunk
+{
+    TokenBuffer *tokens;
+    size_t start;
+    size_t end;
+
+    // Only touched by the thread parsing the chunk
+    Arena arena;
+    AstPool *ast;
+    struct
+    {
+        AstRef *items;
+        size_t count;
+        size_t capacity;
+    } funcs;
+
+    // Where the chunk's pool is copied to in the merged one
+    AstPool *out;
+    AstOffsets at;
+} ParseChunk;
+
+// Number of chunks worth parsing in parallel, 1 for small programs
+int parse_chunk_count(size_t tokens, int jobs)
+{
+    size_t chunks = tokens / PARSE_CHUNK_MIN;
+    if (jobs < 1)
+        jobs = 1;
+    if (chunks > (size_t)jobs)
+        chunks = jobs;
+    return chunks ? (int)chunks : 1;
+}
+
+// Split the tokens after closing braces that bring the brace depth back
+// to zero, which is where top level function definitions end. A chunk
+// ends at the first such brace past its share of the tokens. Names of
+// tokens that were not lexed are interned here, before any thread runs.
+// Returns the number of chunks used, 0 if the braces do not nest.
+static int split_funcs(TokenBuffer *tokens, ParseChunk *chunks, int count)
+{
+    size_t depth = 0;
+    size_t target = tokens->count / count;
+    int k = 0;
+
+    chunks[0].start = 0;
+    for (size_t i = 0; i < tokens->count; i++)
+    {
+        TokenType type = (TokenType)tokens->types[i];
+        if ((type == TOK_IDENT || type == TOK_TYPE) && tokens->values[i].ident == NULL)
+            tokens->values[i].ident = intern(context_interns, tokens->input + tokens->offsets[i], tokens->lengths[i]);
+        else if (type == TOK_LBRACE)
+            depth++;
+        else if (type == TOK_RBRACE)
+        {
+            if (depth == 0)
+                return 0;
+            if (--depth == 0 && i + 1 >= target && k < count - 1)
+            {
+                chunks[k].end = i + 1;
+                chunks[++k].start = i + 1;
+                target = tokens->count / count * (k + 1);
+            }
+        }
+    }
+    chunks[k].end = tokens->count;
+    return k + 1;
+}
+
+static void *parse_chunk(void *arg)
+{
+    ParseChunk *chunk = arg;
+    TokenStream stream;
+
+    chunk->ast = ast_pool_new(&chunk->arena);
+    ast_pool_reserve(chunk->ast, chunk->end - chunk->start);
+    token_stream_init(&stream, chunk->tokens, chunk->ast);
+    stream.current = chunk->start;
+    stream.end = chunk->end;
+
+    while (current_type(&stream) != TOK_EOF)
+        arena_da_append(&chunk->arena, &chunk->funcs, parse_func_def(&stream));
+    return NULL;
+}
+
+static void *copy_chunk(void *arg)
+{
+    ParseChunk *chunk = arg;
+    ast_pool_copy(chunk->out, chunk->ast, chunk->at);
+    return NULL;
+}
+
+// Parse the function definitions of tokens on up to 'jobs' threads, each
+// into a pool of its own, and merge the pools in source order. Produces
+// the same pool as parse().
+AstPool *parse_parallel(TokenBuffer *tokens, int jobs)
+{
+    int count = parse_chunk_count(tokens->count, jobs);
+    if (count == 1)
+        return parse(tokens);
+
+    ParseChunk *chunks = calloc(count, sizeof(ParseChunk));
+    if (chunks == NULL)
+    {
+        perror("Failed to allocate memory.");
+        exit(1);
+    }
+    for (int k = 0; k < count; k++)
+        chunks[k].tokens = tokens;
+
+    count = split_funcs(tokens, chunks, count);
+    if (count <= 1)
+    {
+        free(chunks);
+        return parse(tokens);
+    }
+    run_parallel(parse_chunk, chunks, sizeof(ParseChunk), count);
+
+    AstPool *ast = ast_pool_new(context_arena);
+    size_t nodes = ast->nodes.count;
+    size_t names = ast->names.count;
+    size_t extra = ast->extra.count;
+    size_t funcs = 0;
+    for (int k = 0; k < count; k++)
+    {
+        chunks[k].out = ast;
+        chunks[k].at = (AstOffsets){(uint32_t)nodes, (uint32_t)names, (uint32_t)extra};
+        nodes += chunks[k].ast->nodes.count - 1;
+        names += chunks[k].ast->names.count;
+        extra += chunks[k].ast->extra.count - 1;
+        funcs += chunks[k].funcs.count;
+    }
+    if (nodes > UINT32_MAX || extra + funcs + 1 > UINT32_MAX)
+    {
+        fprintf(stderr, "Too many AST nodes\n");
+        exit(1);
+    }
+
+    // Room for the list of functions behind the copied lists
+    ast_pool_reserve_items(ast, nodes, names, extra + funcs + 1);
+    ast->nodes.count = nodes;
+    ast->names.count = names;
+    ast->extra.count = extra;
+    run_parallel(copy_chunk, chunks, sizeof(ParseChunk), count);
+
+    size_t prog = ast_list_begin(ast);
+    for (int k = 0; k < count; k++)
+    {
+        for (size_t i = 0; i < chunks[k].funcs.count; i++)
+            ast_list_push(ast, ast_rebase_ref(chunks[k].funcs.items[i], chunks[k].at));
+    }
+    ast->funcs = ast_list_end(ast, prog);
+
+    for (int k = 0; k < count; k++)
+    {
+        arena_stats_merge(&context_arena->stats, &chunks[k].arena.stats);
+        arena_free(&chunks[k].arena);
+    }
+    free(chunks);
+    return ast;
+}
@@ -0,0 +1,245 @@
+#include <mylang/scan.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SCAN_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+static bool is_blank_byte(unsigned char c)
+{
+    return c == ' ' || c == '\t' || c == '\n';
+}
+
+static bool is_digit_byte(unsigned char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool is_ident_byte(unsigned char c)
+{
+    // Setting bit 5 folds 'A'-'Z' onto 'a'-'z'
+    unsigned char lower = c | 0x20;
+    return (lower >= 'a' && lower <= 'z') || is_digit_byte(c) || c == '_';
+}
+
+static size_t scalar_blank(const char *input, size_t i, size_t length)
+{
+    while (i < length && is_blank_byte((unsigned char)input[i]))
+        i++;
+    return i;
+}
+
+static size_t scalar_line_end(const char *input, size_t i, size_t length)
+{
+    const char *nl = memchr(input + i, '\n', length - i);
+    return nl ? (size_t)(nl - input) : length;
+}
+
+static size_t scalar_comment_end(const char *input, size_t i, size_t length)
+{
+    // Jump from '*' to '*', the first one followed by '/' ends the comment
+    while (i + 1 < length)
+    {
+        const char *star = memchr(input + i, '*', length - i - 1);
+        if (star == NULL)
+            break;
+        i = star - input;
+        if (input[i + 1] == '/')
+            return i;
+        i++;
+    }
+    return length;
+}
+
+static size_t scalar_ident(const char *input, size_t i, size_t length)
+{
+    while (i < length && is_ident_byte((unsigned char)input[i]))
+        i++;
+    return i;
+}
+
+static const ScanKernels scalar_kernels = {
+    SCAN_SCALAR, "scalar", scalar_blank, scalar_line_end, scalar_comment_end, scalar_ident,
+};
+
+#ifdef SCAN_HAVE_X86
+
+// Byte lanes of v that lie in [lo, hi]. Bytes >= 0x80 compare as
+// negative and so never match an ASCII range.
+static __m128i sse2_in_range(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+}
+
+static size_t sse2_blank(const char *input, size_t i, size_t length)
+{
+    while (i + 16 <= length)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + i));
+        __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(blank);
+        if (mask != 0xFFFF)
+            return i + __builtin_ctz(~mask);
+        i += 16;
+    }
+    return scalar_blank(input, i, length);
+}
+
+static size_t sse2_line_end(const char *input, size_t i, size_t length)
+{
+    while (i + 16 <= length)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        if (mask)
+            return i + __builtin_ctz(mask);
+        i += 16;
+    }
+    return scalar_line_end(input, i, length);
+}
+
+// Compare each byte with the next one to find "*/" in one pass
+static size_t sse2_comment_end(const char *input, size_t i, size_t length)
+{
+    while (i + 17 <= length)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + i));
+        __m128i next = _mm_loadu_si128((const __m128i *)(input + i + 1));
+        __m128i end = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')), _mm_cmpeq_epi8(next, _mm_set1_epi8('/')));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(end);
+        if (mask)
+            return i + __builtin_ctz(mask);
+        i += 16;
+    }
+    return scalar_comment_end(input, i, length);
+}
+
+static size_t sse2_ident(const char *input, size_t i, size_t length)
+{
+    while (i + 16 <= length)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + i));
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i ident = _mm_or_si128(_mm_or_si128(sse2_in_range(lower, 'a', 'z'), sse2_in_range(v, '0', '9')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(ident);
+        if (mask != 0xFFFF)
+            return i + __builtin_ctz(~mask);
+        i += 16;
+    }
+    return scalar_ident(input, i, length);
+}
+
+static const ScanKernels sse2_kernels = {
+    SCAN_SSE2, "sse2", sse2_blank, sse2_line_end, sse2_comment_end, sse2_ident,
+};
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static __m256i avx2_in_range(__m256i v, char lo, char hi)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+AVX2 static size_t avx2_blank(const char *input, size_t i, size_t length)
+{
+    while (i + 32 <= length)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + i));
+        __m256i blank = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(blank);
+        if (mask != 0xFFFFFFFF)
+            return i + __builtin_ctz(~mask);
+        i += 32;
+    }
+    return sse2_blank(input, i, length);
+}
+
+AVX2 static size_t avx2_line_end(const char *input, size_t i, size_t length)
+{
+    while (i + 32 <= length)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        if (mask)
+            return i + __builtin_ctz(mask);
+        i += 32;
+    }
+    return sse2_line_end(input, i, length);
+}
+
+AVX2 static size_t avx2_comment_end(const char *input, size_t i, size_t length)
+{
+    while (i + 33 <= length)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + i));
+        __m256i next = _mm256_loadu_si256((const __m256i *)(input + i + 1));
+        __m256i end = _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')),
+                                       _mm256_cmpeq_epi8(next, _mm256_set1_epi8('/')));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(end);
+        if (mask)
+            return i + __builtin_ctz(mask);
+        i += 32;
+    }
+    return sse2_comment_end(input, i, length);
+}
+
+AVX2 static size_t avx2_ident(const char *input, size_t i, size_t length)
+{
+    while (i + 32 <= length)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + i));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i ident = _mm256_or_si256(
+            _mm256_or_si256(avx2_in_range(lower, 'a', 'z'), avx2_in_range(v, '0', '9')),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(ident);
+        if (mask != 0xFFFFFFFF)
+            return i + __builtin_ctz(~mask);
+        i += 32;
+    }
+    return sse2_ident(input, i, length);
+}
+
+static const ScanKernels avx2_kernels = {
+    SCAN_AVX2, "avx2", avx2_blank, avx2_line_end, avx2_comment_end, avx2_ident,
+};
+
+#endif
+
+// Returns kernels for 'isa', or NULL if this build or CPU lacks it
+const ScanKernels *scan_kernels_for(ScanIsa isa)
+{
+    switch (isa)
+    {
+    case SCAN_SCALAR:
+        return &scalar_kernels;
+#ifdef SCAN_HAVE_X86
+    case SCAN_SSE2:
+        return &sse2_kernels;
+    case SCAN_AVX2:
+        return __builtin_cpu_supports("avx2") ? &avx2_kernels : NULL;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+// Returns the fastest kernels the running CPU supports
+const ScanKernels *scan_kernels(void)
+{
+    const ScanKernels *kernels;
+    if ((kernels = scan_kernels_for(SCAN_AVX2)))
+        return kernels;
+    if ((kernels = scan_kernels_for(SCAN_SSE2)))
+        return kernels;
+    return scan_kernels_for(SCAN_SCALAR);
+}
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 StackFrame *make_stack_frame(char *func)
 {
@@ -27,9 +28,10 @@ int stackframe_add(StackFrame *frame, size_t n, size_t type_size)
 
 Scope *enter_scope(Scope *parent)
 {
-    Scope *child = (Scope *)context_alloc(sizeof(Scope));
+    Scope *child = (Scope *)arena_alloc(parent->arena, sizeof(Scope));
     child->symtab = symtab_clone(parent->symtab);
     child->parent = parent;
+    child->arena = parent->arena;
     return child;
 }
 
@@ -78,16 +80,14 @@ void assert_type_eq(TypeSpecifier type1, TypeSpecifier type2)
     }
 }
 
-TypeSpecifier type_check(AstNode *node)
+TypeSpecifier type_check(AstPool *ast, AstRef ref)
 {
-
+    AstNode *node = ast_node(ast, ref);
     AstCompStmt *comp_stmt;
     AstIfElse *if_stmt;
     AstVarDef *var_def;
     AstBinExp *bin_exp;
     AstFuncDef *func_def;
-    AstIdent *ident;
-    AstFuncCall *func_call;
     AstRet *ret;
     AstVarAsgn *asgn;
     AstWhile *w_stmt;
@@ -102,83 +102,78 @@ TypeSpecifier type_check(AstNode *node)
     switch (node->type)
     {
     case AST_COMP_STMT:
-        comp_stmt = (AstCompStmt *)node->as;
-        for (size_t i = 0; i < comp_stmt->body->length; i++)
-            type_check((AstNode *)vector_get(comp_stmt->body, i));
+        comp_stmt = &node->as.comp_stmt;
+        for (size_t i = 0; i < ast_list_count(ast, comp_stmt->body); i++)
+            type_check(ast, ast_list_get(ast, comp_stmt->body, i));
         return TS_VOID;
     case AST_IF:
-        if_stmt = (AstIfElse *)node->as;
-        type_check(if_stmt->if_body);
+        if_stmt = &node->as.if_else;
+        type_check(ast, if_stmt->if_body);
 
-        if (if_stmt->else_body != NULL)
-            type_check(if_stmt->else_body);
+        if (if_stmt->else_body != AST_NONE)
+            type_check(ast, if_stmt->else_body);
         return TS_VOID;
     case AST_VAR_DEF:
-        var_def = (AstVarDef *)node->as;
+        var_def = &node->as.var_def;
 
-        expected = var_def->symbol->type;
-        actual = type_check(var_def->expr);
+        expected = ast_symbol(ast, ref)->type;
+        actual = type_check(ast, var_def->expr);
 
         assert_type_eq(expected, actual);
         return TS_VOID;
     case AST_BIN_EXP:
-        bin_exp = (AstBinExp *)node->as;
-        expected = type_check(bin_exp->left);
-        actual = type_check(bin_exp->left);
+        bin_exp = &node->as.bin_exp;
+        expected = type_check(ast, bin_exp->left);
+        actual = type_check(ast, bin_exp->left);
 
         assert_type_eq(expected, actual);
         return expected;
     case AST_INT_CONST:
         return TS_INT;
     case AST_FUNC_DEF:
-        func_def = (AstFuncDef *)node->as;
-        type_check(func_def->body);
+        func_def = &node->as.func_def;
+        type_check(ast, ast_func_body(ast, func_def));
         return TS_VOID;
     case AST_IDENT:
-        ident = (AstIdent *)node->as;
-        return ident->symbol->type;
     case AST_FUNC_CALL:
-        func_call = (AstFuncCall *)node->as;
-        return func_call->symbol->type;
+        return ast_symbol(ast, ref)->type;
     case AST_RET:
-        ret = (AstRet *)node->as;
-        expected = ret->func->type;
-        actual = type_check(ret->expr);
+        ret = &node->as.ret;
+        expected = ast_symbol(ast, ref)->type;
+        actual = type_check(ast, ret->expr);
         assert_type_eq(expected, actual);
 
         return expected;
     case AST_VAR_ASGN:
-        asgn = (AstVarAsgn *)node->as;
-        expected = type_check(asgn->lval);
-        actual = type_check(asgn->rval);
+        asgn = &node->as.var_asgn;
+        expected = type_check(ast, asgn->lval);
+        actual = type_check(ast, asgn->rval);
 
         assert_type_eq(expected, actual);
         return expected;
     case AST_WHILE:
-        w_stmt = (AstWhile *)node->as;
-        return type_check(w_stmt->body);
+        w_stmt = &node->as.w_stmt;
+        return type_check(ast, w_stmt->body);
     case AST_FOR:
-        f_stmt = (AstFor *)node->as;
-        return type_check(f_stmt->body);
+        f_stmt = &node->as.f_stmt;
+        return type_check(ast, ast_for_body(ast, f_stmt));
     case AST_EXPR_STMT:
-        expr_stmt = (AstExprStmt *)node->as;
-        return type_check(expr_stmt->expr);
+        expr_stmt = &node->as.expr_stmt;
+        return type_check(ast, expr_stmt->expr);
     case AST_UNARY_EXPR:
-        unary_expr = (AstUnaryExpr *)node->as;
-        return type_check(unary_expr->postfix_expr);
+        unary_expr = &node->as.unary_expr;
+        return type_check(ast, unary_expr->postfix_expr);
     case AST_ENUM:
     case AST_VAR_DEC:
     case AST_EMPTY_EXPR:
         return TS_VOID;
     case AST_LVAL:
-        lval = (AstLValue *)node->as;
-        AstIdent *lval_ident;
+        lval = &node->as.lval;
 
         switch (lval->kind)
         {
         case AST_LVAL_IDENT:
-            lval_ident = (AstIdent *)(lval->u.ident->as);
-            return lval_ident->symbol->type;
+            return ast_symbol(ast, lval->ident)->type;
             break;
 
         default:
@@ -191,9 +186,9 @@ TypeSpecifier type_check(AstNode *node)
     }
 }
 
-void sym_check(AstNode *node, StackFrame *frame, Scope *scope, HashMap *type_env, Vector *symbols)
+void sym_check(AstPool *ast, AstRef ref, StackFrame *frame, Scope *scope, HashMap *type_env, SymbolVec *symbols)
 {
-
+    AstNode *node = ast_node(ast, ref);
     AstCompStmt *comp_stmt;
     AstIfElse *if_stmt;
     AstVarDef *var_def;
@@ -213,191 +208,197 @@ void sym_check(AstNode *node, StackFrame *frame, Scope *scope, HashMap *type_env
     SymTabEntry *entry;
     TypeEnvEntry *entry_type;
     Scope *child;
+    AstList params;
+    char *name;
 
     switch (node->type)
     {
     case AST_COMP_STMT:
-        comp_stmt = (AstCompStmt *)node->as;
+        comp_stmt = &node->as.comp_stmt;
         child = enter_scope(scope);
-        for (size_t i = 0; i < comp_stmt->body->length; i++)
-            sym_check((AstNode *)vector_get(comp_stmt->body, i), frame, child, type_env, symbols);
+        for (size_t i = 0; i < ast_list_count(ast, comp_stmt->body); i++)
+            sym_check(ast, ast_list_get(ast, comp_stmt->body, i), frame, child, type_env, symbols);
         exit_scope(child);
         break;
     case AST_IF:
-        if_stmt = (AstIfElse *)node->as;
-        sym_check(if_stmt->if_body, frame, scope, type_env, symbols);
-        sym_check(if_stmt->if_expr, frame, scope, type_env, symbols);
-        if (if_stmt->else_body != NULL)
-            sym_check(if_stmt->else_body, frame, scope, type_env, symbols);
+        if_stmt = &node->as.if_else;
+        sym_check(ast, if_stmt->if_body, frame, scope, type_env, symbols);
+        sym_check(ast, if_stmt->if_expr, frame, scope, type_env, symbols);
+        if (if_stmt->else_body != AST_NONE)
+            sym_check(ast, if_stmt->else_body, frame, scope, type_env, symbols);
 
         break;
     case AST_VAR_DEF:
-        var_def = (AstVarDef *)node->as;
+        var_def = &node->as.var_def;
+        name = ast_name(ast, var_def->name);
 
         // Check if symbol exists in scope
-        if (in_scope(scope, var_def->value))
+        if (in_scope(scope, name))
         {
             perror("Redefinition of variable.");
             exit(1);
         }
 
-        sym_check(var_def->expr, frame, scope, type_env, symbols);
+        sym_check(ast, var_def->expr, frame, scope, type_env, symbols);
 
-        entry_type = hashmap_get(type_env, var_def->type);
-        entry = make_symtab_entry(str_clone(var_def->value), entry_type->ts, SYM_VARIABLE);
-        vector_push(symbols, entry);
+        entry_type = hashmap_get(type_env, ast_name(ast, var_def->type));
+        entry = make_symtab_entry(name, entry_type->ts, SYM_VARIABLE);
+        SymbolVec_push(symbols, entry);
         entry->offset = stackframe_add(frame, 1, INT_SIZE);
-        var_def->symbol = entry;
+        ast->symbols[ref] = entry;
 
         scope_add(scope, entry);
         break;
     case AST_BIN_EXP:
-        bin_exp = (AstBinExp *)node->as;
-        sym_check(bin_exp->left, frame, scope, type_env, symbols);
-        sym_check(bin_exp->right, frame, scope, type_env, symbols);
+        bin_exp = &node->as.bin_exp;
+        sym_check(ast, bin_exp->left, frame, scope, type_env, symbols);
+        sym_check(ast, bin_exp->right, frame, scope, type_env, symbols);
         break;
     case AST_INT_CONST:
         break;
     case AST_FUNC_DEF:
-        func_def = (AstFuncDef *)node->as;
+        func_def = &node->as.func_def;
+        name = ast_name(ast, func_def->name);
         // Check if symbol exists in table
-        if (in_scope(scope, func_def->value))
+        if (in_scope(scope, name))
         {
-            fprintf(stderr, "Redefinition of function '%s'\n", func_def->value);
+            fprintf(stderr, "Redefinition of function '%s'\n", name);
             exit(1);
         }
 
-        frame = make_stack_frame(func_def->value);
+        frame = make_stack_frame(name);
 
         // Check params
-        for (size_t i = 0; i < func_def->params->length; i++)
+        params = ast_func_params(ast, func_def);
+        for (size_t i = 0; i < ast_list_count(ast, params); i++)
         {
-            Param *param = (Param *)vector_get(func_def->params, i);
-            entry_type = hashmap_get(type_env, param->type);
-            entry = make_symtab_entry(str_clone(param->value), entry_type->ts, SYM_VARIABLE);
-            param->symbol = entry;
+            AstRef param_ref = ast_list_get(ast, params, i);
+            AstParam *param = &ast_node(ast, param_ref)->as.param;
+            entry_type = hashmap_get(type_env, ast_name(ast, param->type));
+            entry = make_symtab_entry(ast_name(ast, param->name), entry_type->ts, SYM_VARIABLE);
+            ast->symbols[param_ref] = entry;
             scope_add(scope, entry);
         }
 
         // Insert params into symbol table
-        TypeEnvEntry *ret_type = hashmap_get(type_env, func_def->type);
-        SymTabEntry *entry = make_symtab_entry(str_clone(func_def->value), ret_type->ts, SYM_FUNCTION);
-        vector_push(symbols, entry);
+        TypeEnvEntry *ret_type = hashmap_get(type_env, ast_name(ast, func_def->type));
+        SymTabEntry *entry = make_symtab_entry(name, ret_type->ts, SYM_FUNCTION);
+        SymbolVec_push(symbols, entry);
 
-        entry->params = func_def->params;
+        entry->param_count = ast_list_count(ast, params);
         entry->frame = frame;
-        func_def->symbol = entry;
+        ast->symbols[ref] = entry;
         scope_add(scope, entry);
 
-        sym_check(func_def->body, frame, scope, type_env, symbols);
+        sym_check(ast, ast_func_body(ast, func_def), frame, scope, type_env, symbols);
 
         break;
     case AST_IDENT:
-        ident = (AstIdent *)node->as;
-        entry = scope_lookup(scope, ident->value);
+        ident = &node->as.ident;
+        entry = scope_lookup(scope, ast_name(ast, ident->name));
         if (entry == NULL)
         {
-            printf("%s\n", ident->value);
+            printf("%s\n", ast_name(ast, ident->name));
             perror("Cannot used undefined variable");
             exit(1);
         }
 
-        ident->symbol = entry;
-        ident->symbol->is_used = true;
+        ast->symbols[ref] = entry;
+        entry->is_used = true;
         break;
     case AST_FUNC_CALL:
-        func_call = (AstFuncCall *)node->as;
-        entry = scope_lookup(scope, func_call->value);
-
-        Vector *args = func_call->args;
-        Vector *params = entry->params;
-        func_call->symbol = entry;
-        func_call->symbol->is_used = true;
+        func_call = &node->as.func_call;
+        name = ast_name(ast, func_call->name);
+        entry = scope_lookup(scope, name);
         if (entry == NULL)
         {
-            fprintf(stderr, "Undefined function '%s'\n", func_call->value);
+            fprintf(stderr, "Undefined function '%s'\n", name);
             exit(1);
         }
 
-        if (params->length != args->length)
+        ast->symbols[ref] = entry;
+        entry->is_used = true;
+
+        if (entry->param_count != ast_list_count(ast, func_call->args))
         {
-            fprintf(stderr, "Mismatching args for function '%s'\n", func_call->value);
+            fprintf(stderr, "Mismatching args for function '%s'\n", name);
             exit(1);
         }
 
-        for (size_t i = 0; i < func_call->args->length; i++)
-            sym_check((AstNode *)vector_get(func_call->args, i), frame, scope, type_env, symbols);
+        for (size_t i = 0; i < ast_list_count(ast, func_call->args); i++)
+            sym_check(ast, ast_list_get(ast, func_call->args, i), frame, scope, type_env, symbols);
 
         break;
     case AST_RET:
-        ret = (AstRet *)node->as;
+        ret = &node->as.ret;
         // Get function symbol
 
         entry = scope_lookup(scope, frame->func);
-        ret->func = entry;
-        sym_check(ret->expr, frame, scope, type_env, symbols);
+        ast->symbols[ref] = entry;
+        sym_check(ast, ret->expr, frame, scope, type_env, symbols);
         break;
     case AST_ENUM:
-        enm = (AstEnum *)node->as;
-        for (size_t i = 0; i < enm->enums->length; i++)
+        enm = &node->as.enm;
+        for (size_t i = 0; i < ast_list_count(ast, enm->enums); i++)
         {
-            entry = make_symtab_entry(vector_get(enm->enums, i), TS_INT, SYM_CONST);
+            entry = make_symtab_entry(ast_name(ast, ast_list_get(ast, enm->enums, i)), TS_INT, SYM_CONST);
             entry->const_value = i;
             scope_add(scope, entry);
         }
         break;
     case AST_VAR_DEC:
-        dec = (AstVarDec *)node->as;
+        dec = &node->as.var_dec;
+        name = ast_name(ast, dec->name);
         // Check if symbol exists in scope
-        if (in_scope(scope, dec->value))
+        if (in_scope(scope, name))
         {
             perror("Redeclaration of variable.");
             exit(1);
         }
 
-        entry_type = hashmap_get(type_env, dec->type);
-        entry = make_symtab_entry(str_clone(dec->value), entry_type->ts, SYM_VARIABLE);
+        entry_type = hashmap_get(type_env, ast_name(ast, dec->type));
+        entry = make_symtab_entry(name, entry_type->ts, SYM_VARIABLE);
         entry->offset = stackframe_add(frame, 1, INT_SIZE);
-        dec->symbol = entry;
+        ast->symbols[ref] = entry;
         scope_add(scope, entry);
         break;
     case AST_VAR_ASGN:
-        asgn = (AstVarAsgn *)node->as;
-        sym_check(asgn->lval, frame, scope, type_env, symbols);
-        sym_check(asgn->rval, frame, scope, type_env, symbols);
+        asgn = &node->as.var_asgn;
+        sym_check(ast, asgn->lval, frame, scope, type_env, symbols);
+        sym_check(ast, asgn->rval, frame, scope, type_env, symbols);
         break;
     case AST_WHILE:
-        w_stmt = (AstWhile *)node->as;
+        w_stmt = &node->as.w_stmt;
 
-        sym_check(w_stmt->expr, frame, scope, type_env, symbols);
-        sym_check(w_stmt->body, frame, scope, type_env, symbols);
+        sym_check(ast, w_stmt->expr, frame, scope, type_env, symbols);
+        sym_check(ast, w_stmt->body, frame, scope, type_env, symbols);
 
         break;
 
     case AST_FOR:
-        f_stmt = (AstFor *)node->as;
+        f_stmt = &node->as.f_stmt;
         child = enter_scope(scope);
 
-        sym_check(f_stmt->init, frame, child, type_env, symbols);
-        sym_check(f_stmt->cond, frame, child, type_env, symbols);
-        sym_check(f_stmt->step, frame, child, type_env, symbols);
-        sym_check(f_stmt->body, frame, child, type_env, symbols);
+        sym_check(ast, f_stmt->init, frame, child, type_env, symbols);
+        sym_check(ast, f_stmt->cond, frame, child, type_env, symbols);
+        sym_check(ast, ast_for_step(ast, f_stmt), frame, child, type_env, symbols);
+        sym_check(ast, ast_for_body(ast, f_stmt), frame, child, type_env, symbols);
 
         exit_scope(child);
         break;
     case AST_EXPR_STMT:
-        expr_stmt = (AstExprStmt *)node->as;
-        sym_check(expr_stmt->expr, frame, scope, type_env, symbols);
+        expr_stmt = &node->as.expr_stmt;
+        sym_check(ast, expr_stmt->expr, frame, scope, type_env, symbols);
         break;
     case AST_UNARY_EXPR:
-        unary_expr = (AstUnaryExpr *)node->as;
+        unary_expr = &node->as.unary_expr;
 
-        sym_check(unary_expr->postfix_expr, frame, scope, type_env, symbols);
+        sym_check(ast, unary_expr->postfix_expr, frame, scope, type_env, symbols);
         break;
 
     case AST_LVAL:
-        lvalue = (AstLValue *)node->as;
-        sym_check(lvalue->u.ident, frame, scope, type_env, symbols);
+        lvalue = &node->as.lval;
+        sym_check(ast, lvalue->ident, frame, scope, type_env, symbols);
         break;
     case AST_EMPTY_EXPR:
         break;
@@ -407,39 +408,48 @@ void sym_check(AstNode *node, StackFrame *frame, Scope *scope, HashMap *type_env
     }
 }
 
-void warn_unused(Vector *symbols)
+void warn_unused(SymbolVec *symbols)
 {
     SymTabEntry *symbol;
-    for (size_t i = 0; i < symbols->length; i++)
+    for (size_t i = 0; i < symbols->count; i++)
     {
-        symbol = (SymTabEntry *)vector_get(symbols, i);
+        symbol = symbols->items[i];
         if (!symbol->is_used && strcmp(symbol->key, "main"))
-            printf(COLOR_YELLOW "warning:" COLOR_RESET " unused variable " COLOR_BOLD "'%s'\n" COLOR_RESET,
-                   symbol->key);
+            diagnostic(COLOR_YELLOW "warning:" COLOR_RESET " unused variable " COLOR_BOLD "'%s'\n" COLOR_RESET,
+                       symbol->key);
     }
 }
 
-Vector *sema_check(Vector *prog, HashMap *type_env)
+SymbolVec *sema_check(AstPool *ast, HashMap *type_env)
 {
-    AstNode *node;
-    HashMap *symtab = hashmap_new();
-    Vector *symbols = vector_new();
+    AstRef node;
+    // Every name in the AST is interned, scopes compare them by pointer
+    HashMap *symtab = hashmap_new_interned();
+    SymbolVec *symbols = context_alloc(sizeof(SymbolVec));
+    memset(symbols, 0, sizeof(SymbolVec));
+
+    ast->symbols = arena_alloc(ast->arena, ast->nodes.count * sizeof(SymTabEntry *));
+    memset(ast->symbols, 0, ast->nodes.count * sizeof(SymTabEntry *));
 
-    Scope *global = (Scope *)context_alloc(sizeof(Scope));
+    Arena scopes = {0};
+    Scope *global = (Scope *)arena_alloc(&scopes, sizeof(Scope));
     global->symtab = symtab;
     global->parent = NULL;
     global->id = 0;
-    for (size_t i = 0; i < prog->length; i++)
+    global->arena = &scopes;
+    for (size_t i = 0; i < ast_list_count(ast, ast->funcs); i++)
     {
-        node = (AstNode *)vector_get(prog, i);
-        sym_check(node, NULL, global, type_env, symbols);
+        node = ast_list_get(ast, ast->funcs, i);
+        sym_check(ast, node, NULL, global, type_env, symbols);
     }
     exit_scope(global);
+    arena_stats_merge(&context_arena->stats, &scopes.stats);
+    arena_free(&scopes);
 
-    for (size_t i = 0; i < prog->length; i++)
+    for (size_t i = 0; i < ast_list_count(ast, ast->funcs); i++)
     {
-        node = (AstNode *)vector_get(prog, i);
-        type_check(node);
+        node = ast_list_get(ast, ast->funcs, i);
+        type_check(ast, node);
     }
 
     warn_unused(symbols);
@@ -0,0 +1,151 @@
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <mylang/scan.h>
+#include <mylang/source.h>
+#include <mylang/util.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SOURCE_READ_CHUNK (64 * 1024)
+#define LINE_INDEX_INIT_SIZE 256
+
+// Read everything from fd into the context arena, used for
+// pipes, stdin and anything else that cannot be mapped
+static bool source_read(Source *source, int fd)
+{
+    size_t capacity = SOURCE_READ_CHUNK;
+    size_t length = 0;
+    char *data = context_alloc(capacity);
+
+    for (;;)
+    {
+        if (length == capacity)
+        {
+            data = arena_realloc(context_arena, data, capacity, capacity * 2);
+            capacity *= 2;
+        }
+
+        ssize_t n = read(fd, data + length, capacity - length);
+        if (n < 0)
+            return false;
+        if (n == 0)
+            break;
+        length += n;
+    }
+
+    source->data = data;
+    source->length = length;
+    source->mapped = false;
+    return true;
+}
+
+// Load source from file_name, "-" reads stdin
+// Returns false if the file could not be read
+bool source_open(Source *source, const char *file_name)
+{
+    struct stat st;
+    bool ok;
+
+    if (!strcmp(file_name, "-"))
+        return source_read(source, STDIN_FILENO);
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            // The lexer reads front to back, let the kernel read ahead
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            source->data = data;
+            source->length = st.st_size;
+            source->mapped = true;
+            close(fd);
+            return true;
+        }
+    }
+
+    ok = source_read(source, fd);
+    close(fd);
+    return ok;
+}
+
+void source_close(Source *source)
+{
+    if (source->mapped)
+        munmap((void *)source->data, source->length);
+
+    source->data = NULL;
+    source->length = 0;
+    source->mapped = false;
+}
+
+// Record where every line starts, one newline search per line
+LineIndex *line_index_new(const char *input, size_t length)
+{
+    const ScanKernels *scan = scan_kernels();
+    LineIndex *index = context_alloc(sizeof(LineIndex));
+    size_t capacity = LINE_INDEX_INIT_SIZE;
+
+    index->starts = context_alloc(capacity * sizeof(size_t));
+    index->starts[0] = 0;
+    index->count = 1;
+
+    for (size_t i = scan->line_end(input, 0, length); i < length; i = scan->line_end(input, i + 1, length))
+    {
+        if (index->count == capacity)
+        {
+            index->starts =
+                arena_realloc(context_arena, index->starts, capacity * sizeof(size_t), capacity * 2 * sizeof(size_t));
+            capacity *= 2;
+        }
+        index->starts[index->count++] = i + 1;
+    }
+    return index;
+}
+
+// Binary search for the line containing offset
+SourcePos line_index_lookup(const LineIndex *index, size_t offset)
+{
+    // Invariant: starts[lo] <= offset < starts[hi]
+    size_t lo = 0;
+    size_t hi = index->count;
+    while (hi - lo > 1)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->starts[mid] <= offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    SourcePos pos;
+    pos.line = (int)lo + 1;
+    pos.column = (int)(offset - index->starts[lo]) + 1;
+    return pos;
+}
+
+// One-off lookup for error paths that report a single position.
+// Counts the lines in front of offset without allocating, so it
+// is safe to call from any thread.
+SourcePos source_pos(const char *input, size_t length, size_t offset)
+{
+    const ScanKernels *scan = scan_kernels();
+    SourcePos pos = {1, 1};
+    size_t line_start = 0;
+
+    if (offset > length)
+        offset = length;
+    for (size_t i = scan->line_end(input, 0, offset); i < offset; i = scan->line_end(input, i + 1, offset))
+    {
+        pos.line++;
+        line_start = i + 1;
+    }
+    pos.column = (int)(offset - line_start) + 1;
+    return pos;
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+extern "C"
+{
+#include <mylang/arena.h>
+}
+
+TEST(Arena, Stats)
+{
+    Arena arena = {};
+    arena_alloc(&arena, 10);
+    EXPECT_EQ(1u, arena.stats.regions);
+    EXPECT_EQ(10u, arena.stats.requested);
+    EXPECT_EQ(sizeof(uintptr_t) * 2, arena.stats.used);
+
+    // Does not fit in the first region, whatever size the backend gave it
+    Arena_Mark mark = arena_snapshot(&arena);
+    arena_alloc(&arena, (arena.begin->capacity + 1) * sizeof(uintptr_t));
+    EXPECT_EQ(2u, arena.stats.regions);
+    EXPECT_EQ(1u, arena.stats.oversized);
+    size_t peak = arena.stats.used;
+    EXPECT_GT(arena.stats.reserved, peak);
+
+    // Rewinding frees the usage but keeps the peak
+    arena_rewind(&arena, mark);
+    EXPECT_EQ(sizeof(uintptr_t) * 2, arena.stats.used);
+    EXPECT_EQ(peak, arena.stats.peak);
+
+    // A freed arena counts on top of what is in use
+    Arena_Stats total = {};
+    total.used = 100;
+    arena_free(&arena);
+    arena_stats_merge(&total, &arena.stats);
+    EXPECT_EQ(2u, total.regions);
+    EXPECT_EQ(100 + peak, total.peak);
+
+    // Live arenas add up what they use, not their peaks
+    Arena_Stats live = {};
+    live.used = 100;
+    live.peak = 150;
+    Arena_Stats other = {};
+    other.regions = 1;
+    other.used = 70;
+    other.peak = 120;
+    arena_stats_add(&live, &other);
+    EXPECT_EQ(1u, live.regions);
+    EXPECT_EQ(170u, live.used);
+    EXPECT_EQ(170u, live.peak);
+    other.peak = 200;
+    arena_stats_add(&live, &other);
+    EXPECT_EQ(240u, live.used);
+    EXPECT_EQ(240u, live.peak);
+}
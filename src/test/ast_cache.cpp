@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+extern "C"
+{
+#include <mylang/ast.h>
+#include <mylang/ast_cache.h>
+#include <mylang/hashmap.h>
+#include <mylang/lex.h>
+#include <mylang/parse.h>
+#include <mylang/sema.h>
+#include <mylang/util.h>
+}
+
+static const char *cache_input = "int add(int a, int b){ enum E { A, B }; int unused = B; return a + b; }\n"
+                                 "int main(){ int x = add(1, 2); for (int i = 0; i < 3; i = i + 1) { x = x + i; } "
+                                 "return x; }";
+
+static AstPool *checked_ast(const char *input, SymbolVec **symbols)
+{
+    HashMap *type_env = hashmap_new();
+    type_env_init(type_env);
+    AstPool *ast = parse(tokenize(input, strlen(input)));
+    *symbols = sema_check(ast, type_env);
+    return ast;
+}
+
+static std::string cache_file(char *dir, const char *input)
+{
+    uint64_t hash = hash_bytes(input, strlen(input));
+    EXPECT_TRUE(mkdtemp(dir) != NULL);
+    return ast_cache_path(dir, hash);
+}
+
+TEST(AstCache, RoundTrip)
+{
+    char dir[] = "/tmp/mylang-cache-XXXXXX";
+    std::string path = cache_file(dir, cache_input);
+    uint64_t hash = hash_bytes(cache_input, strlen(cache_input));
+    size_t length = strlen(cache_input);
+
+    SymbolVec *written_symbols;
+    AstPool *written = checked_ast(cache_input, &written_symbols);
+    ASSERT_TRUE(ast_cache_write(path.c_str(), written, written_symbols, hash, length));
+
+    SymbolVec *loaded_symbols;
+    AstPool *loaded = ast_cache_load(path.c_str(), hash, length, &loaded_symbols);
+    ASSERT_NE(loaded, nullptr);
+
+    ASSERT_EQ(written->nodes.count, loaded->nodes.count);
+    EXPECT_EQ(0, memcmp(written->nodes.items, loaded->nodes.items, written->nodes.count * sizeof(AstNode)));
+    ASSERT_EQ(written->extra.count, loaded->extra.count);
+    EXPECT_EQ(0, memcmp(written->extra.items, loaded->extra.items, written->extra.count * sizeof(uint32_t)));
+    ASSERT_EQ(written->names.count, loaded->names.count);
+    for (size_t i = 0; i < written->names.count; i++)
+        EXPECT_EQ(written->names.items[i], loaded->names.items[i]) << i;
+    EXPECT_EQ(written->funcs, loaded->funcs);
+
+    // Symbols are rebuilt field by field
+    for (AstRef ref = 0; ref < written->nodes.count; ref++)
+    {
+        SymTabEntry *a = ast_symbol(written, ref);
+        SymTabEntry *b = ast_symbol(loaded, ref);
+        ASSERT_EQ(a == NULL, b == NULL) << ref;
+        if (a == NULL)
+            continue;
+        EXPECT_EQ(a->key, b->key);
+        EXPECT_EQ(a->symbol, b->symbol);
+        EXPECT_EQ(a->type, b->type);
+        EXPECT_EQ(a->offset, b->offset);
+        EXPECT_EQ(a->param_count, b->param_count);
+        EXPECT_EQ(a->const_value, b->const_value);
+        EXPECT_EQ(a->is_used, b->is_used);
+        ASSERT_EQ(a->frame == NULL, b->frame == NULL);
+        if (a->frame)
+        {
+            EXPECT_EQ(a->frame->size, b->frame->size);
+            EXPECT_EQ(a->frame->func, b->frame->func);
+        }
+    }
+    AstRef add = ast_list_get(loaded, loaded->funcs, 0);
+    AstRef param = ast_list_get(loaded, ast_func_params(loaded, &ast_node(loaded, add)->as.func_def), 0);
+    EXPECT_EQ(ast_symbol(loaded, param)->frame, nullptr);
+
+    ASSERT_EQ(written_symbols->count, loaded_symbols->count);
+    for (size_t i = 0; i < written_symbols->count; i++)
+        EXPECT_EQ(written_symbols->items[i]->key, loaded_symbols->items[i]->key);
+
+    EXPECT_NE(loaded->mapping, nullptr);
+    ast_cache_close(loaded);
+    EXPECT_EQ(loaded->mapping, nullptr);
+
+    unlink(path.c_str());
+    rmdir(dir);
+    arena_free(context_arena);
+}
+
+TEST(AstCache, RejectsStaleOrDamagedFiles)
+{
+    char dir[] = "/tmp/mylang-cache-XXXXXX";
+    std::string path = cache_file(dir, cache_input);
+    uint64_t hash = hash_bytes(cache_input, strlen(cache_input));
+    size_t length = strlen(cache_input);
+    SymbolVec *symbols;
+
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash, length, &symbols), nullptr);
+
+    AstPool *ast = checked_ast(cache_input, &symbols);
+    ASSERT_TRUE(ast_cache_write(path.c_str(), ast, symbols, hash, length));
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash + 1, length, &symbols), nullptr);
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash, length + 1, &symbols), nullptr);
+    ASSERT_NE(ast_cache_load(path.c_str(), hash, length, &symbols), nullptr);
+
+    // Flip a byte in the middle of the file
+    FILE *file = fopen(path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, size / 2, SEEK_SET);
+    int c = fgetc(file);
+    fseek(file, size / 2, SEEK_SET);
+    fputc(c ^ 1, file);
+    fclose(file);
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash, length, &symbols), nullptr);
+
+    ASSERT_EQ(0, truncate(path.c_str(), size - 8));
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash, length, &symbols), nullptr);
+    ASSERT_EQ(0, truncate(path.c_str(), 16));
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash, length, &symbols), nullptr);
+
+    unlink(path.c_str());
+    rmdir(dir);
+    arena_free(context_arena);
+}
+
+typedef struct CacheWriteItem
+{
+    const char *path;
+    AstPool *ast;
+    SymbolVec *symbols;
+    bool ok;
+} CacheWriteItem;
+
+static void *write_cache(void *arg)
+{
+    CacheWriteItem *item = (CacheWriteItem *)arg;
+    Arena arena = {};
+    Context saved = context_swap(Context{&arena, NULL, NULL});
+    item->ok = true;
+    for (int i = 0; i < 20; i++)
+        item->ok = ast_cache_write(item->path, item->ast, item->symbols, hash_bytes(cache_input, strlen(cache_input)),
+                                   strlen(cache_input)) &&
+                   item->ok;
+    context_swap(saved);
+    arena_free(&arena);
+    return NULL;
+}
+
+// Batch jobs with the same source write the same cache file at once
+TEST(AstCache, ConcurrentWrites)
+{
+    char dir[] = "/tmp/mylang-cache-XXXXXX";
+    std::string path = cache_file(dir, cache_input);
+    SymbolVec *symbols;
+    AstPool *ast = checked_ast(cache_input, &symbols);
+
+    CacheWriteItem items[4];
+    for (auto &item : items)
+        item = CacheWriteItem{path.c_str(), ast, symbols, false};
+    run_parallel(write_cache, items, sizeof(CacheWriteItem), 4);
+    for (auto &item : items)
+        EXPECT_TRUE(item.ok);
+
+    AstPool *loaded = ast_cache_load(path.c_str(), hash_bytes(cache_input, strlen(cache_input)), strlen(cache_input),
+                                     &symbols);
+    ASSERT_NE(loaded, nullptr);
+    ast_cache_close(loaded);
+
+    // No temporary file is left behind
+    unlink(path.c_str());
+    EXPECT_EQ(0, rmdir(dir));
+    arena_free(context_arena);
+}
+
+// Nodes are stored as they are, a bad index with a valid checksum has to
+// be caught before anything follows it
+TEST(AstCache, RejectsOutOfRangeIndices)
+{
+    char dir[] = "/tmp/mylang-cache-XXXXXX";
+    std::string path = cache_file(dir, cache_input);
+    uint64_t hash = hash_bytes(cache_input, strlen(cache_input));
+    size_t length = strlen(cache_input);
+    SymbolVec *symbols;
+
+    AstPool *ast = checked_ast(cache_input, &symbols);
+    EXPECT_TRUE(ast_pool_valid(ast));
+    AstNode *bin = NULL, *call = NULL, *ident = NULL;
+    for (AstRef ref = 1; ref < ast->nodes.count; ref++)
+    {
+        AstNode *node = ast_node(ast, ref);
+        if (node->type == AST_BIN_EXP && !bin)
+            bin = node;
+        else if (node->type == AST_FUNC_CALL && !call)
+            call = node;
+        else if (node->type == AST_IDENT && !ident)
+            ident = node;
+    }
+    ASSERT_TRUE(bin && call && ident);
+
+    AstRef right = bin->as.bin_exp.right;
+    bin->as.bin_exp.right = ast->nodes.count;
+    EXPECT_FALSE(ast_pool_valid(ast));
+    ASSERT_TRUE(ast_cache_write(path.c_str(), ast, symbols, hash, length));
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash, length, &symbols), nullptr);
+    bin->as.bin_exp.right = right;
+
+    AstName name = ident->as.ident.name;
+    ident->as.ident.name = ast->names.count;
+    EXPECT_FALSE(ast_pool_valid(ast));
+    ASSERT_TRUE(ast_cache_write(path.c_str(), ast, symbols, hash, length));
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash, length, &symbols), nullptr);
+    ident->as.ident.name = name;
+
+    // A list running past the end of extra
+    AstList args = call->as.func_call.args;
+    call->as.func_call.args = ast->extra.count - 1;
+    EXPECT_FALSE(ast_pool_valid(ast));
+    ASSERT_TRUE(ast_cache_write(path.c_str(), ast, symbols, hash, length));
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash, length, &symbols), nullptr);
+    call->as.func_call.args = args;
+
+    EXPECT_TRUE(ast_pool_valid(ast));
+    ASSERT_TRUE(ast_cache_write(path.c_str(), ast, symbols, hash, length));
+    AstPool *loaded = ast_cache_load(path.c_str(), hash, length, &symbols);
+    ASSERT_NE(loaded, nullptr);
+    ast_cache_close(loaded);
+
+    unlink(path.c_str());
+    rmdir(dir);
+    arena_free(context_arena);
+}
+
+static void expect_rejected(const std::string &path, AstPool *ast, SymbolVec *symbols)
+{
+    uint64_t hash = hash_bytes(cache_input, strlen(cache_input));
+    size_t length = strlen(cache_input);
+    ASSERT_TRUE(ast_cache_write(path.c_str(), ast, symbols, hash, length));
+    EXPECT_EQ(ast_cache_load(path.c_str(), hash, length, &symbols), nullptr);
+}
+
+// Codegen follows the symbols and frames of nodes without checking them
+TEST(AstCache, RejectsMissingSymbols)
+{
+    char dir[] = "/tmp/mylang-cache-XXXXXX";
+    std::string path = cache_file(dir, cache_input);
+    SymbolVec *symbols;
+
+    AstPool *ast = checked_ast(cache_input, &symbols);
+    AstRef ident = AST_NONE, bin = AST_NONE;
+    for (AstRef ref = 1; ref < ast->nodes.count; ref++)
+    {
+        if (ast_node(ast, ref)->type == AST_IDENT && !ident)
+            ident = ref;
+        else if (ast_node(ast, ref)->type == AST_BIN_EXP && !bin)
+            bin = ref;
+    }
+    ASSERT_TRUE(ident && bin);
+    SymTabEntry *func = ast_symbol(ast, ast_list_get(ast, ast->funcs, 0));
+
+    SymTabEntry *symbol = ast->symbols[ident];
+    ast->symbols[ident] = NULL;
+    expect_rejected(path, ast, symbols);
+    ast->symbols[ident] = symbol;
+
+    StackFrame *frame = func->frame;
+    func->frame = NULL;
+    expect_rejected(path, ast, symbols);
+    func->frame = frame;
+
+    symbol->arg_reg = 8;
+    expect_rejected(path, ast, symbols);
+    symbol->arg_reg = 0;
+
+    symbol->type = (TypeSpecifier)(TS_FLOAT + 1);
+    expect_rejected(path, ast, symbols);
+    symbol->type = TS_INT;
+
+    TokenType op = ast_node(ast, bin)->as.bin_exp.op_type;
+    ast_node(ast, bin)->as.bin_exp.op_type = TOK_EOF;
+    expect_rejected(path, ast, symbols);
+    ast_node(ast, bin)->as.bin_exp.op_type = op;
+
+    uint64_t hash = hash_bytes(cache_input, strlen(cache_input));
+    ASSERT_TRUE(ast_cache_write(path.c_str(), ast, symbols, hash, strlen(cache_input)));
+    AstPool *loaded = ast_cache_load(path.c_str(), hash, strlen(cache_input), &symbols);
+    ASSERT_NE(loaded, nullptr);
+    ast_cache_close(loaded);
+
+    unlink(path.c_str());
+    rmdir(dir);
+    arena_free(context_arena);
+}
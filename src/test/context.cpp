@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+extern "C"
+{
+#include <mylang/intern.h>
+#include <mylang/util.h>
+}
+
+TEST(Context, SwapAndDiagnostics)
+{
+    Arena arena = {};
+    InternTable interns = {};
+    char *messages = NULL;
+    size_t length = 0;
+    FILE *diagnostics = open_memstream(&messages, &length);
+    ASSERT_NE(diagnostics, nullptr);
+
+    Context saved = context_swap(Context{&arena, &interns, diagnostics});
+    EXPECT_EQ(&arena, context_arena);
+    EXPECT_EQ(&interns, context_interns);
+    context_alloc(16);
+    diagnostic("warning: %s\n", "unused");
+    Context job = context_swap(saved);
+
+    EXPECT_EQ(&arena, job.arena);
+    EXPECT_EQ(saved.arena, context_arena);
+    EXPECT_EQ(saved.interns, context_interns);
+    EXPECT_EQ(saved.diagnostics, context_diagnostics);
+    EXPECT_EQ(1u, arena.stats.regions);
+
+    fclose(diagnostics);
+    EXPECT_EQ(std::string("warning: unused\n"), std::string(messages, length));
+    free(messages);
+    arena_free(&arena);
+}
+
+static void *record_arena(void *arg)
+{
+    *(Arena **)arg = context_arena;
+    return NULL;
+}
+
+TEST(Context, WorkerThreadsHaveNone)
+{
+    Arena *seen[4];
+    run_parallel(record_arena, seen, sizeof(Arena *), 4);
+    // The first item runs on the calling thread
+    EXPECT_EQ(context_arena, seen[0]);
+    for (int k = 1; k < 4; k++)
+        EXPECT_EQ(nullptr, seen[k]);
+}
+
+static void *alloc_from_context(void *arg)
+{
+    (void)arg;
+    context_alloc(16);
+    return NULL;
+}
+
+static void *intern_into_context(void *arg)
+{
+    (void)arg;
+    intern_cstr(context_interns, "name");
+    return NULL;
+}
+
+TEST(Context, WorkerThreadsFailWithoutContext)
+{
+    int items[2];
+    EXPECT_EXIT(run_parallel(alloc_from_context, items, sizeof(int), 2), ::testing::ExitedWithCode(1),
+                "no compilation context");
+    EXPECT_EXIT(run_parallel(intern_into_context, items, sizeof(int), 2), ::testing::ExitedWithCode(1),
+                "no intern table to intern 'name'");
+}
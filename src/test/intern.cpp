@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+extern "C"
+{
+#include <mylang/hashmap.h>
+#include <mylang/intern.h>
+#include <mylang/lex.h>
+}
+
+TEST(Intern, SameTextSamePointer)
+{
+    InternTable table = {};
+    const char *src = "count counter count";
+
+    char *a = intern(&table, src, 5);
+    char *b = intern(&table, src + 14, 5);
+    char *c = intern(&table, src + 6, 7);
+
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_STREQ("count", a);
+    EXPECT_STREQ("counter", c);
+    EXPECT_EQ(intern_length(c), 7);
+    EXPECT_EQ(intern_hash(a), hash_bytes("count", 5));
+    intern_free(&table);
+}
+
+TEST(Intern, SurvivesGrowth)
+{
+    InternTable table = {};
+    std::vector<char *> names;
+    for (int i = 0; i < 5000; i++)
+        names.push_back(intern_cstr(&table, ("name" + std::to_string(i)).c_str()));
+
+    for (int i = 0; i < 5000; i++)
+        EXPECT_EQ(names[i], intern_cstr(&table, ("name" + std::to_string(i)).c_str()));
+    EXPECT_EQ(table.count, 5000);
+    intern_free(&table);
+}
+
+TEST(Intern, LexerInternsIdentifiers)
+{
+    const char *src = "int x = x + y; return x;";
+    TokenBuffer *tokens = tokenize(src, strlen(src));
+
+    Token type = token_at(tokens, 0);
+    Token x1 = token_at(tokens, 1);
+    Token x2 = token_at(tokens, 3);
+    Token ret = token_at(tokens, 7);
+
+    EXPECT_EQ(type.ident, intern_cstr(context_interns, "int"));
+    EXPECT_EQ(x1.ident, x2.ident);
+    EXPECT_TRUE(ret.ident == NULL);
+    arena_free(context_arena);
+}
+
+TEST(Intern, InternedMapComparesPointers)
+{
+    HashMap *map = hashmap_new_interned();
+    char *key = intern_cstr(context_interns, "key");
+    int data = 1;
+
+    hashmap_add(map, &data, key);
+    EXPECT_EQ(&data, hashmap_get(map, intern_cstr(context_interns, "key")));
+    EXPECT_TRUE(hashmap_get(map, intern_cstr(context_interns, "other")) == NULL);
+    hashmap_free(map);
+}
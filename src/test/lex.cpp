@@ -1,5 +1,6 @@
 
 #include <gtest/gtest.h>
+#include <set>
 extern "C"
 {
 #include <mylang/lex.h>
@@ -19,13 +20,13 @@ class LexParamTest : public ::testing::TestWithParam<LexCase>
 TEST_P(LexParamTest, MatchesExpectedTokens)
 {
     auto [in, expected] = GetParam();
-    Vector *tokens = tokenize(in, strlen(in));
-    ASSERT_EQ(tokens->length, expected.size());
+    TokenBuffer *tokens = tokenize(in, strlen(in));
+    ASSERT_EQ(tokens->count, expected.size());
     for (size_t i = 0; i < expected.size(); ++i)
     {
-        Token *t = (Token *)vector_get(tokens, i);
-        char *str = as_str(t->value);
-        EXPECT_EQ(t->type, expected[i].first);
+        Token t = token_at(tokens, i);
+        char *str = token_str(in, &t);
+        EXPECT_EQ(t.type, expected[i].first);
         EXPECT_STREQ(str, expected[i].second);
     }
     arena_free(context_arena);
@@ -76,6 +77,23 @@ INSTANTIATE_TEST_SUITE_P(
                  {TOK_NOT_EQUAL, "!="},
                  {TOK_SEMICOLON, ";"}}},
 
+        // Multi-character operators use maximal munch
+        LexCase{"<<<=<>>>=>&&&||!=!=",
+                {{TOK_LSHIFT, "<<"},
+                 {TOK_LT_EQ, "<="},
+                 {TOK_LT, "<"},
+                 {TOK_RSHIFT, ">>"},
+                 {TOK_GT_EQ, ">="},
+                 {TOK_GT, ">"},
+                 {TOK_LOG_AND, "&&"},
+                 {TOK_AND, "&"},
+                 {TOK_LOG_OR, "||"},
+                 {TOK_NOT_EQUAL, "!="},
+                 {TOK_NOT_EQUAL, "!="}}},
+
+        // Operator at end of input
+        LexCase{"x<", {{TOK_IDENT, "x"}, {TOK_LT, "<"}}},
+
         // Braces and parentheses
         LexCase{"(){}", {{TOK_LPAREN, "("}, {TOK_RPAREN, ")"}, {TOK_LBRACE, "{"}, {TOK_RBRACE, "}"}}},
 
@@ -89,9 +107,25 @@ INSTANTIATE_TEST_SUITE_P(
                  {TOK_TYPE, "int"},
                  {TOK_TYPE, "void"}}},
 
+        // Type keywords
+        LexCase{"char long float double", {{TOK_TYPE, "char"}, {TOK_TYPE, "long"}, {TOK_TYPE, "float"}, {TOK_TYPE, "double"}}},
+
+        // Identifiers that share a prefix, length or hash slot with a keyword
+        LexCase{"i in integer ints fur elsewhere", {{TOK_IDENT, "i"},
+                                                  {TOK_IDENT, "in"},
+                                                  {TOK_IDENT, "integer"},
+                                                  {TOK_IDENT, "ints"},
+                                                  {TOK_IDENT, "fur"},
+                                                  {TOK_IDENT, "elsewhere"}}},
+
         // Identifiers and digits
         LexCase{"foo bar123 42", {{TOK_IDENT, "foo"}, {TOK_IDENT, "bar123"}, {TOK_NUM, "42"}}},
 
+        // Block comments, including ones that span lines or hold '*' and "//"
+        LexCase{"a /* one */ b /**/ c /* ** / // \n */ d /***/ e",
+                {{TOK_IDENT, "a"}, {TOK_IDENT, "b"}, {TOK_IDENT, "c"}, {TOK_IDENT, "d"}, {TOK_IDENT, "e"}}},
+        LexCase{"x /*/ y */ / z", {{TOK_IDENT, "x"}, {TOK_DIV, "/"}, {TOK_IDENT, "z"}}},
+
         // Mixed whitespace
         LexCase{"\t\n x = 5 ; \n", {{TOK_IDENT, "x"}, {TOK_ASSIGN, "="}, {TOK_NUM, "5"}, {TOK_SEMICOLON, ";"}}},
 
@@ -113,3 +147,172 @@ INSTANTIATE_TEST_SUITE_P(
                  {TOK_SEMICOLON, ";"}}}
 
         ));
+
+// The keyword hash has to stay collision free over all of C99
+// so that every keyword can be added to the table as it is supported
+TEST(Lex, KeywordHashCoversC99)
+{
+    const char *c_keywords[] = {"auto",     "break",  "case",     "char",   "const",    "continue", "default",
+                                "do",       "double", "else",     "enum",   "extern",   "float",    "for",
+                                "goto",     "if",     "inline",   "int",    "long",     "register", "restrict",
+                                "return",   "short",  "signed",   "sizeof", "static",   "struct",   "switch",
+                                "typedef",  "union",  "unsigned", "void",   "volatile", "while",    "_Bool",
+                                "_Complex", "_Imaginary"};
+    std::set<unsigned> slots;
+    for (const char *kw : c_keywords)
+    {
+        size_t n = strlen(kw);
+        unsigned slot = KEYWORD_HASH(n, (unsigned char)kw[0], (unsigned char)kw[n - 1]);
+        EXPECT_TRUE(slots.insert(slot).second) << kw << " collides in slot " << slot;
+    }
+}
+
+TEST(Lex, IntegerConstants)
+{
+    struct
+    {
+        const char *input;
+        uint64_t value;
+        unsigned char suffix;
+    } cases[] = {
+        {"0", 0, 0},
+        {"42", 42, 0},
+        {"017", 15, 0},
+        {"0x1F", 31, 0},
+        {"0XffU", 255, NUM_UNSIGNED},
+        {"0b101", 5, 0},
+        {"10l", 10, NUM_LONG},
+        {"10uLL", 10, NUM_UNSIGNED | NUM_LONG_LONG},
+        {"10llu", 10, NUM_UNSIGNED | NUM_LONG_LONG},
+        {"18446744073709551615u", UINT64_MAX, NUM_UNSIGNED},
+    };
+    for (auto &c : cases)
+    {
+        TokenBuffer *tokens = tokenize(c.input, strlen(c.input));
+        ASSERT_EQ(tokens->count, 1) << c.input;
+        Token t = token_at(tokens, 0);
+        EXPECT_EQ(t.type, TOK_NUM) << c.input;
+        EXPECT_EQ(t.value, c.value) << c.input;
+        EXPECT_EQ(t.suffix, c.suffix) << c.input;
+        EXPECT_EQ(t.length, strlen(c.input)) << c.input;
+    }
+    arena_free(context_arena);
+}
+
+TEST(Lex, InvalidIntegerConstants)
+{
+    const char *too_large = "18446744073709551616";
+    const char *octal = "09";
+    const char *suffix = "10lL";
+    const char *empty_hex = "0x;";
+    EXPECT_EXIT(tokenize(too_large, strlen(too_large)), ::testing::ExitedWithCode(1), "too large");
+    EXPECT_EXIT(tokenize(octal, strlen(octal)), ::testing::ExitedWithCode(1), "octal");
+    EXPECT_EXIT(tokenize(suffix, strlen(suffix)), ::testing::ExitedWithCode(1), "suffix");
+    EXPECT_EXIT(tokenize(empty_hex, strlen(empty_hex)), ::testing::ExitedWithCode(1), "no digits");
+}
+
+TEST(Lex, UnterminatedBlockComment)
+{
+    const char *src = "int x;\n/* no end *";
+    EXPECT_EXIT(tokenize(src, strlen(src)), ::testing::ExitedWithCode(1), "Unterminated comment at line: 2, column: 1");
+}
+
+TEST(Lex, ParallelMatchesSerial)
+{
+    // Large comments make most split targets land inside one. Their
+    // lines would not lex ("09" is an invalid octal constant).
+    std::string src;
+    for (int i = 0; src.size() < 3 * LEX_CHUNK_MIN; i++)
+    {
+        src += "int f" + std::to_string(i % 500) + "(int a) { return a + 0x" + std::to_string(i) + "; }\n";
+        if (i % 1000 == 0)
+        {
+            src += "/*\n";
+            for (int j = 0; j < 20000; j++)
+                src += "09 09 09\n";
+            src += "*/ int g; // trailing /* not a comment\n";
+        }
+    }
+
+    TokenBuffer *serial = tokenize(src.c_str(), src.size());
+    for (int jobs = 2; jobs <= 4; jobs++)
+    {
+        ASSERT_GT(lex_chunk_count(src.size(), jobs), 1);
+        TokenBuffer *parallel = tokenize_parallel(src.c_str(), src.size(), jobs);
+        ASSERT_EQ(parallel->count, serial->count) << jobs;
+        for (size_t i = 0; i < serial->count; i++)
+        {
+            Token a = token_at(serial, i);
+            Token b = token_at(parallel, i);
+            ASSERT_EQ(a.type, b.type) << i;
+            ASSERT_EQ(a.offset, b.offset) << i;
+            ASSERT_EQ(a.length, b.length) << i;
+            ASSERT_EQ(a.ident, b.ident) << i;
+            ASSERT_EQ(a.value, b.value) << i;
+            ASSERT_EQ(a.suffix, b.suffix) << i;
+        }
+    }
+    arena_free(context_arena);
+}
+
+struct EditCase
+{
+    const char *find;
+    size_t skip;
+    size_t remove;
+    const char *text;
+    bool far;
+};
+
+TEST(Lex, EditMatchesFullRelex)
+{
+    std::string text = "int x; /* one */ int y; /* two */\n";
+    for (int i = 0; i < 200; i++)
+        text += "int f" + std::to_string(i) + "(int a) { return a << 0x" + std::to_string(i) + "; }\n";
+    TokenBuffer *tokens = tokenize(text.c_str(), text.size());
+    std::vector<std::string> texts = {text};
+
+    // Each edit is placed relative to the first match of find in the
+    // text left by the previous one
+    std::vector<EditCase> edits = {
+        {"f0", 1, 1, "g", false},               // rename f0
+        {"g(", 0, 1, "gg h", false},            // split into two tokens
+        {"<< 0x0", 0, 1, "", false},            // '<<' becomes '<'
+        {"one */", 4, 2, "", true},             // comment now ends after "two"
+        {"one ", 4, 0, "*/", true},             // and is closed again
+        {"f1(", 0, 0, "x", false},              // glue onto the identifier
+        {"int f2", 0, 0, "// ", false},         // comment out a line
+        {"// int f2", 0, 3, "", false},         // and bring it back
+        {"0x199; }", 8, 0, "\nint z;", false},  // append at the end
+    };
+
+    for (const EditCase &e : edits)
+    {
+        std::string next = texts.back();
+        size_t start = next.find(e.find);
+        ASSERT_NE(start, std::string::npos) << e.find;
+        start += e.skip;
+        next.replace(start, e.remove, e.text);
+        texts.push_back(next);
+        const std::string &curr = texts.back();
+
+        TextEdit edit = {start, start + e.remove, start + strlen(e.text)};
+        size_t lexed = token_buffer_edit(tokens, curr.c_str(), curr.size(), edit);
+        TokenBuffer *expected = tokenize(curr.c_str(), curr.size());
+
+        ASSERT_EQ(tokens->count, expected->count) << e.find;
+        for (size_t i = 0; i < expected->count; i++)
+        {
+            Token a = token_at(expected, i);
+            Token b = token_at(tokens, i);
+            ASSERT_EQ(a.type, b.type) << e.find << " " << i;
+            ASSERT_EQ(a.offset, b.offset) << e.find << " " << i;
+            ASSERT_EQ(a.length, b.length) << e.find << " " << i;
+            ASSERT_EQ(a.ident, b.ident) << e.find << " " << i;
+            ASSERT_EQ(a.value, b.value) << e.find << " " << i;
+        }
+        if (!e.far)
+            EXPECT_LT(lexed, 20) << e.find;
+    }
+    arena_free(context_arena);
+}
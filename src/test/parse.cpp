@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <string>
 extern "C"
 {
 #include <mylang/ast.h>
@@ -10,22 +11,152 @@ extern "C"
 
 TEST(Parse, Variable)
 {
-    Vector *tokens;
+    TokenBuffer *tokens;
     TokenStream *stream;
-    HashMap *symtab;
-    AstNode *var;
+    AstRef var;
 
-    tokens = vector_new();
+    const char *input = "int var = 10;";
 
-    vector_push(tokens, make_token(TOK_TYPE, string((char *)"int"), 0, 0));
-    vector_push(tokens, make_token(TOK_IDENT, string((char *)"var"), 0, 0));
-    vector_push(tokens, make_token(TOK_ASSIGN, string((char *)"="), 0, 0));
-    vector_push(tokens, make_token(TOK_NUM, string((char *)"10"), 0, 0));
+    tokens = token_buffer_new(input, strlen(input), 5);
+
+    token_buffer_push(tokens, make_token(TOK_TYPE, 0, 3));
+    token_buffer_push(tokens, make_token(TOK_IDENT, 4, 3));
+    token_buffer_push(tokens, make_token(TOK_ASSIGN, 8, 1));
+    token_buffer_push(tokens, make_token(TOK_NUM, 10, 2));
+    token_buffer_push(tokens, make_token(TOK_SEMICOLON, 12, 1));
 
     stream = make_token_stream(tokens);
 
     var = parse_var_def(stream);
 
-    EXPECT_EQ(AST_VAR_DEF, var->type);
+    EXPECT_EQ(AST_VAR_DEF, ast_node(stream->ast, var)->type);
     arena_free(context_arena);
-}
\ No newline at end of file
+}
+TEST(Parse, StreamMatchesTokenVector)
+{
+    const char *input = "int add(int a, int b){ return a + b; }\n"
+                        "int main(){ enum E { A, B }; int x = add(1, 2); if (x >= 3) { x = x << 1; } return x; }";
+    size_t length = strlen(input);
+
+    AstPool *from_tokens = parse(tokenize(input, length));
+    AstPool *from_lexer = parse_source(input, length);
+
+    // Both build the same pool, node for node
+    ASSERT_EQ(from_tokens->nodes.count, from_lexer->nodes.count);
+    ASSERT_EQ(ast_list_count(from_tokens, from_tokens->funcs), 2);
+    EXPECT_EQ(0, memcmp(from_tokens->nodes.items, from_lexer->nodes.items, from_tokens->nodes.count * sizeof(AstNode)));
+    ASSERT_EQ(from_tokens->names.count, from_lexer->names.count);
+    for (size_t i = 0; i < from_tokens->names.count; i++)
+        EXPECT_EQ(from_tokens->names.items[i], from_lexer->names.items[i]);
+
+    AstFuncDef *add = &ast_node(from_tokens, ast_list_get(from_tokens, from_tokens->funcs, 0))->as.func_def;
+    EXPECT_STREQ("add", ast_name(from_tokens, add->name));
+    EXPECT_STREQ("int", ast_name(from_tokens, add->type));
+    EXPECT_EQ(2, ast_list_count(from_tokens, ast_func_params(from_tokens, add)));
+    AstNode *body = ast_node(from_tokens, ast_func_body(from_tokens, add));
+    ASSERT_EQ(AST_COMP_STMT, body->type);
+    EXPECT_EQ(1, ast_list_count(from_tokens, body->as.comp_stmt.body));
+    arena_free(context_arena);
+}
+
+static std::string render(AstPool *ast, AstRef ref)
+{
+    AstNode *node = ast_node(ast, ref);
+    if (node->type == AST_IDENT)
+        return ast_name(ast, node->as.ident.name);
+    if (node->type == AST_INT_CONST)
+        return std::to_string(node->as.int_const.value);
+    AstBinExp *bin = &node->as.bin_exp;
+    return "(" + render(ast, bin->left) + " " + token_spelling(bin->op_type) + " " + render(ast, bin->right) + ")";
+}
+
+TEST(Parse, BinaryPrecedence)
+{
+    struct
+    {
+        const char *input;
+        const char *expected;
+    } cases[] = {
+        {"a - b - c", "((a - b) - c)"},
+        {"a + b * c / d", "(a + ((b * c) / d))"},
+        {"a << 1 + b < c == d", "(((a << (1 + b)) < c) == d)"},
+        {"a || b && c | d ^ e & f", "(a || (b && (c | (d ^ (e & f)))))"},
+        {"(a || b) * c >= d != e", "((((a || b) * c) >= d) != e)"},
+    };
+
+    for (auto &c : cases)
+    {
+        TokenStream *stream = make_token_stream(tokenize(c.input, strlen(c.input)));
+        EXPECT_EQ(c.expected, render(stream->ast, parse_expression(stream))) << c.input;
+    }
+    arena_free(context_arena);
+}
+
+TEST(Parse, FlatPool)
+{
+    const char *input = "int f(int a){ for (int i = 0; i < a; i = i + 1) { a = a - 1; } return a; }";
+    AstPool *ast = parse(tokenize(input, strlen(input)));
+
+    EXPECT_EQ(16, sizeof(AstNode));
+    EXPECT_EQ(AST_EMPTY_EXPR, ast_node(ast, AST_NONE)->type);
+
+    // Children are added before their parents
+    AstRef func = ast_list_get(ast, ast->funcs, 0);
+    EXPECT_EQ(ast->nodes.count - 1, func);
+    AstNode *body = ast_node(ast, ast_func_body(ast, &ast_node(ast, func)->as.func_def));
+    ASSERT_EQ(2, ast_list_count(ast, body->as.comp_stmt.body));
+
+    AstNode *loop = ast_node(ast, ast_list_get(ast, body->as.comp_stmt.body, 0));
+    ASSERT_EQ(AST_FOR, loop->type);
+    EXPECT_EQ(AST_VAR_DEF, ast_node(ast, loop->as.f_stmt.init)->type);
+    EXPECT_EQ(AST_BIN_EXP, ast_node(ast, loop->as.f_stmt.cond)->type);
+    EXPECT_EQ(AST_VAR_ASGN, ast_node(ast, ast_for_step(ast, &loop->as.f_stmt))->type);
+    EXPECT_EQ(AST_COMP_STMT, ast_node(ast, ast_for_body(ast, &loop->as.f_stmt))->type);
+    EXPECT_LT(ast_for_body(ast, &loop->as.f_stmt), func);
+    arena_free(context_arena);
+}
+
+TEST(Parse, ParallelMatchesSerial)
+{
+    // Every kind of node, so every kind is rebased when the pools are merged
+    std::string src;
+    for (int i = 0; src.size() < 5 * PARSE_CHUNK_MIN * SOURCE_BYTES_PER_TOKEN; i++)
+    {
+        std::string f = "f" + std::to_string(i);
+        src += "int " + f + "(int a, int b) { enum E { X, Y }; int c; c = a; int d = " + f +
+               "(a, b) + !c; for (int i = 0; i < b; i = i + 1) { c = c + i; } while (c > 3) { c = c - 1; } "
+               "if (a == b) { return 1; } else { return d; } return c; }\n";
+    }
+
+    TokenBuffer *tokens = tokenize(src.c_str(), src.size());
+    AstPool *serial = parse(tokens);
+    for (int jobs = 2; jobs <= 4; jobs++)
+    {
+        ASSERT_EQ(parse_chunk_count(tokens->count, jobs), jobs);
+        AstPool *parallel = parse_parallel(tokens, jobs);
+
+        // The merged pool is laid out exactly like the serial one
+        ASSERT_EQ(serial->nodes.count, parallel->nodes.count) << jobs;
+        EXPECT_EQ(0, memcmp(serial->nodes.items, parallel->nodes.items, serial->nodes.count * sizeof(AstNode)));
+        ASSERT_EQ(serial->extra.count, parallel->extra.count) << jobs;
+        EXPECT_EQ(0, memcmp(serial->extra.items, parallel->extra.items, serial->extra.count * sizeof(uint32_t)));
+        ASSERT_EQ(serial->names.count, parallel->names.count) << jobs;
+        EXPECT_EQ(0, memcmp(serial->names.items, parallel->names.items, serial->names.count * sizeof(char *)));
+        EXPECT_EQ(serial->funcs, parallel->funcs);
+    }
+    arena_free(context_arena);
+}
+
+TEST(Parse, UnexpectedEndOfInput)
+{
+    const char *call = "int main() { f(";
+    const char *call_args = "int main() { f(1, ";
+    const char *params = "int main( int";
+
+    EXPECT_EXIT(parse_source(call, strlen(call)), ::testing::ExitedWithCode(1),
+                "Unexpected end of input at line: 1, column: 16");
+    EXPECT_EXIT(parse_source(call_args, strlen(call_args)), ::testing::ExitedWithCode(1), "Unexpected end of input");
+    EXPECT_EXIT(parse_source(params, strlen(params)), ::testing::ExitedWithCode(1),
+                "Unexpected end of input at line: 1, column: 14");
+    EXPECT_EXIT(parse(tokenize(params, strlen(params))), ::testing::ExitedWithCode(1), "Unexpected end of input");
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+extern "C"
+{
+#include <mylang/lex.h>
+#include <mylang/scan.h>
+}
+
+// Random source made of the byte kinds the kernels care about
+static std::string random_source(std::mt19937 &rng, size_t length)
+{
+    const char alphabet[] = "    \t\n\nabcXYZ_09/*;+\x80\xff";
+    std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 2);
+    std::string s;
+    for (size_t i = 0; i < length; i++)
+        s.push_back(alphabet[pick(rng)]);
+    return s;
+}
+
+class ScanIsaTest : public ::testing::TestWithParam<ScanIsa>
+{
+};
+
+TEST_P(ScanIsaTest, MatchesScalar)
+{
+    const ScanKernels *kernels = scan_kernels_for(GetParam());
+    const ScanKernels *scalar = scan_kernels_for(SCAN_SCALAR);
+    if (kernels == NULL)
+        GTEST_SKIP() << "ISA not supported on this machine";
+
+    std::mt19937 rng(42);
+    for (int round = 0; round < 200; round++)
+    {
+        std::string s = random_source(rng, round);
+        // Long runs so the vector loops are exercised
+        s += std::string(round % 70, round % 2 ? ' ' : 'a') + "\n" + std::string(round % 40, '7');
+        for (size_t i = 0; i <= s.size(); i++)
+        {
+            EXPECT_EQ(kernels->blank(s.data(), i, s.size()), scalar->blank(s.data(), i, s.size()));
+            EXPECT_EQ(kernels->line_end(s.data(), i, s.size()), scalar->line_end(s.data(), i, s.size()));
+            EXPECT_EQ(kernels->comment_end(s.data(), i, s.size()), scalar->comment_end(s.data(), i, s.size()));
+            EXPECT_EQ(kernels->ident(s.data(), i, s.size()), scalar->ident(s.data(), i, s.size()));
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, ScanIsaTest, ::testing::Values(SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2));
+
+TEST(Scan, LineNumbersAcrossLongRuns)
+{
+    std::string src = "a" + std::string(100, ' ') + "\n\n" + std::string(40, '\t') + "// " + std::string(90, 'c') +
+                      "\n" + std::string(70, 'b') + "\n   12";
+    TokenBuffer *tokens = tokenize(src.c_str(), src.size());
+    ASSERT_EQ(tokens->count, 3);
+
+    LineIndex *lines = line_index_new(src.c_str(), src.size());
+    Token b = token_at(tokens, 1);
+    Token num = token_at(tokens, 2);
+    SourcePos b_pos = line_index_lookup(lines, b.offset);
+    SourcePos num_pos = line_index_lookup(lines, num.offset);
+    EXPECT_EQ(b_pos.line, 4);
+    EXPECT_EQ(b_pos.column, 1);
+    EXPECT_EQ(b.length, 70);
+    EXPECT_EQ(num_pos.line, 5);
+    EXPECT_EQ(num_pos.column, 4);
+    arena_free(context_arena);
+}
+
+TEST(Scan, BlockCommentLines)
+{
+    std::string src = "/* license\n" + std::string(200, '*') + "\n" + std::string(100, ' ') + "*/\nint x;";
+    TokenBuffer *tokens = tokenize(src.c_str(), src.size());
+    ASSERT_EQ(tokens->count, 3);
+
+    SourcePos pos = source_pos(src.c_str(), src.size(), token_at(tokens, 0).offset);
+    EXPECT_EQ(pos.line, 4);
+    EXPECT_EQ(pos.column, 1);
+    arena_free(context_arena);
+}
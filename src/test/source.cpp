@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+extern "C"
+{
+#include <mylang/source.h>
+#include <mylang/util.h>
+}
+
+TEST(Source, MapsRegularFile)
+{
+    std::string contents = "int main(){ return 0; }\n";
+    char path[] = "/tmp/mylang-source-XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, contents.data(), contents.size()), (ssize_t)contents.size());
+    close(fd);
+
+    Source source;
+    ASSERT_TRUE(source_open(&source, path));
+    EXPECT_TRUE(source.mapped);
+    EXPECT_EQ(std::string(source.data, source.length), contents);
+
+    source_close(&source);
+    EXPECT_EQ(source.data, nullptr);
+    unlink(path);
+}
+
+TEST(Source, EmptyFileIsNotMapped)
+{
+    char path[] = "/tmp/mylang-source-XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    Source source;
+    ASSERT_TRUE(source_open(&source, path));
+    EXPECT_FALSE(source.mapped);
+    EXPECT_EQ(source.length, 0);
+
+    source_close(&source);
+    unlink(path);
+    arena_free(context_arena);
+}
+
+TEST(Source, MissingFile)
+{
+    Source source;
+    EXPECT_FALSE(source_open(&source, "/nonexistent/mylang/file.c"));
+}
+
+TEST(Source, LineIndexLookup)
+{
+    const char *src = "ab\n\n\tcd\nlast";
+    LineIndex *lines = line_index_new(src, strlen(src));
+    ASSERT_EQ(lines->count, 4);
+
+    struct
+    {
+        size_t offset;
+        int line;
+        int column;
+    } cases[] = {{0, 1, 1}, {1, 1, 2}, {2, 1, 3}, {3, 2, 1}, {5, 3, 2}, {8, 4, 1}, {11, 4, 4}};
+    for (auto &c : cases)
+    {
+        SourcePos pos = line_index_lookup(lines, c.offset);
+        EXPECT_EQ(pos.line, c.line) << c.offset;
+        EXPECT_EQ(pos.column, c.column) << c.offset;
+    }
+    arena_free(context_arena);
+}
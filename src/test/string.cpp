@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <string>
 extern "C"
 {
 #include <mylang/util.h>
@@ -29,3 +30,27 @@ TEST(String, AsStr)
     EXPECT_STREQ(str, target);
     arena_free(context_arena);
 }
+
+TEST(String, GrowsPastInlineStorage)
+{
+    std::string expect;
+    String *s = string((char *)"short");
+    EXPECT_TRUE(string_eq(s, (char *)"short"));
+    EXPECT_FALSE(string_eq(s, (char *)"shorter"));
+
+    expect = "short";
+    for (int i = 0; i < 100; i++)
+    {
+        string_append(s, 'a' + i % 26);
+        expect += 'a' + i % 26;
+        ASSERT_EQ(s->length, expect.size());
+        ASSERT_STREQ(as_str(s), expect.c_str());
+    }
+
+    String *clone = string_clone(s);
+    EXPECT_TRUE(string_eq(clone, (char *)expect.c_str()));
+    string_append(clone, '!');
+    EXPECT_TRUE(string_eq(s, (char *)expect.c_str()));
+    EXPECT_FALSE(string_eq(clone, (char *)expect.c_str()));
+    arena_free(context_arena);
+}
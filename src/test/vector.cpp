@@ -9,6 +9,14 @@ struct VectorData
 {
 };
 
+struct Pair
+{
+    int a;
+    int b;
+};
+
+DEFINE_VEC(PairVec, Pair)
+
 TEST(Vector, Get)
 {
     VectorData *ptrs[3];
@@ -62,4 +70,39 @@ TEST(Vector, Resize)
     }
     EXPECT_EQ(VECTOR_INIT_SIZE * 2, v->size);
     arena_free(context_arena);
-}
\ No newline at end of file
+}
+
+TEST(Vector, TypedStoresByValue)
+{
+    PairVec v = {};
+    for (int i = 0; i < 100; i++)
+        PairVec_push(&v, Pair{i, -i});
+    ASSERT_EQ(100u, v.count);
+
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(i, PairVec_at(&v, i)->a);
+        EXPECT_EQ(-i, v.items[i].b);
+    }
+
+    arena_free(context_arena);
+}
+
+TEST(Vector, GrowsInPlace)
+{
+    Vector *v = vector_new();
+    void **array = v->array;
+    for (int i = 0; i < 1000; i++)
+        vector_push(v, &v->array);
+    // Nothing was allocated after the array, so it was extended in place
+    EXPECT_EQ(array, v->array);
+
+    // Once something is allocated behind it, growing has to copy it
+    context_alloc(1);
+    for (size_t i = v->length, size = v->size; i <= size; i++)
+        vector_push(v, &v->array);
+    EXPECT_NE(array, v->array);
+    EXPECT_EQ(&v->array, v->array[v->length - 1]);
+
+    arena_free(context_arena);
+}
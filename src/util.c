@@ -1,7 +1,11 @@
+#define _DEFAULT_SOURCE
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
+#include <mylang/intern.h>
 #include <mylang/util.h>
+#include <pthread.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,13 +14,36 @@
 #include <mylang/arena.h>
 
 Arena default_arena = {0};
-Arena *context_arena = &default_arena;
+__thread Arena *context_arena = &default_arena;
+__thread FILE *context_diagnostics = NULL;
 
 void *context_alloc(size_t size)
 {
-    assert(context_arena);
+    // Worker threads of run_parallel() have no context
+    if (context_arena == NULL)
+    {
+        fprintf(stderr, "my-lang: no compilation context to allocate from on this thread\n");
+        exit(1);
+    }
     return arena_alloc(context_arena, size);
 }
+
+Context context_swap(Context ctx)
+{
+    Context old = {context_arena, context_interns, context_diagnostics};
+    context_arena = ctx.arena;
+    context_interns = ctx.interns;
+    context_diagnostics = ctx.diagnostics;
+    return old;
+}
+
+void diagnostic(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(context_diagnostics ? context_diagnostics : stdout, format, args);
+    va_end(args);
+}
 /* Convert string s to int out.
  *
  * @param[out] out The converted int. Cannot be NULL.
@@ -135,73 +162,71 @@ void *vector_get(Vector *vector, size_t index)
 
 String *string_new(void)
 {
-    // Allocate struct
     String *string = (String *)context_alloc(sizeof(String));
-    // Allocate inital string
-    Vector *vector = vector_new();
-
     string->length = 0;
-    string->vector = vector;
-
+    string->capacity = STRING_INLINE_SIZE - 1;
+    string->data.small[0] = '\0';
     return string;
 }
 
 String *string(char *str)
 {
     String *s = string_new();
-    int i = 0;
-    while (str[i] != '\0')
-    {
-        string_append(s, str[i]);
-        i++;
-    }
+    string_append_many(s, str, strlen(str));
     return s;
 }
 
+// The bytes of string, valid until it grows
+char *string_data(String *string)
+{
+    return string->capacity < STRING_INLINE_SIZE ? string->data.small : string->data.heap;
+}
+
+// Make room for at least 'length' bytes, doubling to keep appends amortised O(1)
+static void string_reserve(String *string, size_t length)
+{
+    if (length <= string->capacity)
+        return;
+
+    size_t capacity = string->capacity * 2;
+    if (capacity < length)
+        capacity = length;
+    char *heap = context_alloc(capacity + 1);
+    memcpy(heap, string_data(string), string->length + 1);
+    string->data.heap = heap;
+    string->capacity = capacity;
+}
+
 String *string_clone(String *string)
 {
     String *s = string_new();
-    char *c;
-    for (size_t i = 0; i < string->length; i++)
-    {
-        c = (char *)vector_get(string->vector, i);
-        string_append(s, *c);
-    }
+    string_append_many(s, string_data(string), string->length);
     return s;
 }
 
 bool string_eq(String *string, char *cmp)
 {
-    if (string->length != strlen(cmp))
-        return false;
-    char *c;
-    for (size_t i = 0; i < string->length; i++)
-    {
-        c = (char *)vector_get(string->vector, i);
-        if (*c != cmp[i])
-            return false;
-    }
-    return true;
+    return string->length == strlen(cmp) && !memcmp(string_data(string), cmp, string->length);
 }
 
 void string_append(String *string, char c)
 {
-    char *n = (char *)context_alloc(sizeof(char));
-    *n = c;
+    string_append_many(string, &c, 1);
+}
 
-    vector_push(string->vector, (void *)n);
-    string->length += 1;
+void string_append_many(String *string, const char *str, size_t length)
+{
+    string_reserve(string, string->length + length);
+    char *data = string_data(string);
+    memcpy(data + string->length, str, length);
+    string->length += length;
+    data[string->length] = '\0';
 }
 
+// The string as a C string, not copied. Valid until the string grows.
 char *as_str(String *string)
 {
-    char *s = (char *)context_alloc(sizeof(char) * string->length + 1);
-    for (size_t i = 0; i < string->length; i++)
-    {
-        s[i] = *((char *)vector_get(string->vector, i));
-    }
-    s[string->length] = '\0';
-    return s;
+    return string_data(string);
 }
 
 char *int_to_str(int num, int size)
@@ -210,3 +235,48 @@ char *int_to_str(int num, int size)
     snprintf(str, size, "%d", num);
     return str;
 }
+
+typedef struct ParallelItem
+{
+    void *(*work)(void *);
+    void *item;
+} ParallelItem;
+
+// Items bring arenas of their own. Using the context on a worker thread
+// would mean sharing default_arena with other threads, so there is none
+// and context_alloc() or intern() on context_interns exit instead.
+static void *run_item(void *arg)
+{
+    ParallelItem *item = arg;
+    context_swap((Context){NULL, NULL, NULL});
+    return item->work(item->item);
+}
+
+// Call work on each of the count items of size bytes at items, every item
+// but the first on its own thread. Items a thread could not be started
+// for are run on the calling thread. Returns when all calls are done.
+void run_parallel(void *(*work)(void *), void *items, size_t size, int count)
+{
+    pthread_t *threads = my_malloc(count * sizeof(pthread_t));
+    ParallelItem *parallel = my_malloc(count * sizeof(ParallelItem));
+    bool *threaded = my_malloc(count * sizeof(bool));
+    char *item = items;
+
+    for (int k = 1; k < count; k++)
+    {
+        parallel[k] = (ParallelItem){work, item + k * size};
+        threaded[k] = pthread_create(&threads[k], NULL, run_item, &parallel[k]) == 0;
+        if (!threaded[k])
+            work(item + k * size);
+    }
+    work(item);
+
+    for (int k = 1; k < count; k++)
+    {
+        if (threaded[k])
+            pthread_join(threads[k], NULL);
+    }
+    free(threaded);
+    free(parallel);
+    free(threads);
+}